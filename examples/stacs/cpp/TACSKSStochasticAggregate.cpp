@@ -0,0 +1,364 @@
+#include "TACSAssembler.h"
+#include "TACSKSStochasticAggregate.h"
+#include "TACSStochasticElement.h"
+
+TACSKSStochasticAggregate::TACSKSStochasticAggregate( TACSAssembler *tacs,
+                                                      TACSFunction *dfunc,
+                                                      ParameterContainer *pc,
+                                                      int quantityType,
+                                                      int moment_type,
+                                                      double ksWeight,
+                                                      int elementQuadrature )
+  : TACSFunction(dfunc->getAssembler(),
+                 dfunc->getDomainType(),
+                 TACSFunction::SINGLE_STAGE,
+                 0)
+{
+  this->tacs_comm = tacs->getMPIComm();
+  this->dfunc = dfunc;
+  this->dfunc->incref();
+  this->pc = pc;
+  this->quantityType = quantityType;
+  this->moment_type = moment_type;
+  this->ksWeight = ksWeight;
+  this->elementQuadrature = elementQuadrature;
+  this->nsqpts  = pc->getNumQuadraturePoints();
+  this->nsterms = pc->getNumBasisTerms();
+  this->fvals    = new TacsScalar[nsqpts];
+  this->ksAccum  = new TacsScalar[2*nsqpts];
+  this->reduction = new TACSStochasticReduction(this->tacs_comm);
+  this->ks_pending = 0;
+}
+
+TACSKSStochasticAggregate::~TACSKSStochasticAggregate()
+{
+  delete this->reduction;
+  delete [] this->fvals;
+  delete [] this->ksAccum;
+}
+
+/*
+  Call point(n, pt, weight) at each spatial point of the element with
+  its integration weight: the quadrature points of the element basis
+  weighted by the determinant of the Jacobian, or a single point with
+  unit weight
+*/
+template <class Point>
+void TACSKSStochasticAggregate::integrateElement( TACSElement *delem,
+                                                  const TacsScalar Xpts[],
+                                                  Point point ){
+  if (!elementQuadrature){
+    double pt[3] = {0.0,0.0,0.0};
+    const int N = 1;
+    point(N, pt, 1.0);
+    return;
+  }
+
+  TACSElementBasis *basis = delem->getElementBasis();
+  if (basis){
+    for ( int i = 0; i < basis->getNumQuadraturePoints(); i++ ){
+      double pt[3];
+      double weight = basis->getQuadraturePoint(i, pt);
+      TacsScalar Xd[9], J[9];
+      TacsScalar detJ = basis->getJacobianTransform(i, pt, Xpts, Xd, J);
+      point(i, pt, weight*detJ);
+    }
+  }
+}
+
+void TACSKSStochasticAggregate::initEvaluation( EvaluationType ftype )
+{
+  finishEvaluation();
+  // The maximum is tracked while summing, nothing to do on INITIALIZE
+  if (ftype == TACSFunction::INTEGRATE){
+    TACSStochasticReduction::initLogSumExp(ksAccum, nsqpts);
+  }
+}
+
+void TACSKSStochasticAggregate::elementWiseEval( EvaluationType evalType,
+                                                 int elemIndex,
+                                                 TACSElement *element,
+                                                 double time,
+                                                 TacsScalar tscale,
+                                                 const TacsScalar Xpts[],
+                                                 const TacsScalar v[],
+                                                 const TacsScalar dv[],
+                                                 const TacsScalar ddv[] )
+{
+  if (evalType != TACSFunction::INTEGRATE){
+    return;
+  }
+
+  TACSStochasticElement *selem = dynamic_cast<TACSStochasticElement*>(element);
+  if (!selem) {
+    printf("Casting to stochastic element failed; skipping elemenwiseEval");
+  };
+
+  TACSElement *delem = selem->getDeterministicElement();
+  const int nsparams = pc->getNumParameters();
+  const int nddof    = delem->getNumVariables();
+
+  // Scratch arrays are taken from the workspace of this thread
+  TACSStochasticWorkspace::Frame work;
+
+  // Space for quadrature points and weights
+  TacsScalar *zq = work.allocate(nsparams);
+  TacsScalar *yq = work.allocate(nsparams);
+
+  // Deterministic states at every quadrature node in y, reconstructed
+  // from the stochastic states in one product
+  TacsScalar *uc     = work.allocate(3*nsqpts*nddof);
+  const TacsScalar *vecs[3] = {v, dv, ddv};
+  selem->getDeterministicStates(0, nsqpts, 3, vecs, uc);
+
+  // Stochastic Integration
+  for (int q = 0; q < nsqpts; q++){
+
+    // Get the quadrature points and weights for mean
+    pc->quadrature(q, zq, yq);
+
+    // Set the parameter values into the element
+    TACSElement *qelem = selem->getParameterizedElement(q, delem, yq);
+
+    // Form the state vectors
+    const TacsScalar *uq   = &uc[3*q*nddof];
+    const TacsScalar *udq  = &uq[nddof];
+    const TacsScalar *uddq = &uq[2*nddof];
+
+    integrateElement(delem, Xpts, [&]( int n, double pt[], TacsScalar weight ){
+        TacsScalar value = 0.0;
+        qelem->evalPointQuantity(elemIndex,
+                                 this->quantityType,
+                                 time, n, pt,
+                                 Xpts, uq, udq, uddq,
+                                 &value);
+
+        // Add up the contribution from the quadrature, rescaling the
+        // sum when the maximum grows
+        TACSStochasticReduction::addLogSumExp(&ksAccum[2*q], ksWeight*value,
+                                              tscale*weight);
+      });
+
+  } // end yloop
+}
+
+void TACSKSStochasticAggregate::finalEvaluation( EvaluationType evalType )
+{
+  // Merge the (max, sum) pairs of all processors in one collective;
+  // the KS values at the quadrature points are formed once they arrive
+  if (evalType == TACSFunction::INTEGRATE){
+    this->reduction->allreduceLogSumExp(ksAccum, nsqpts);
+    this->ks_pending = 1;
+  }
+}
+
+/*
+  Complete the pending reduction and form the KS value at each
+  quadrature point
+*/
+void TACSKSStochasticAggregate::finishEvaluation()
+{
+  this->reduction->wait();
+  if (this->ks_pending){
+    for (int q = 0; q < nsqpts; q++){
+      fvals[q] = (ksAccum[2*q] + log(ksAccum[2*q+1]))/ksWeight;
+    }
+    this->ks_pending = 0;
+  }
+}
+
+/*
+  Overlap the reductions over the processors with the next function
+*/
+void TACSKSStochasticAggregate::setNonblockingReduction( int flag )
+{
+  finishEvaluation();
+  this->reduction->setNonblocking(flag);
+}
+
+void TACSKSStochasticAggregate::getElementSVSens( int elemIndex, TACSElement *element,
+                                                  double time,
+                                                  TacsScalar alpha, TacsScalar beta,
+                                                  TacsScalar gamma,
+                                                  const TacsScalar Xpts[],
+                                                  const TacsScalar v[],
+                                                  const TacsScalar dv[],
+                                                  const TacsScalar ddv[],
+                                                  TacsScalar dfdu[] ){
+  finishEvaluation();
+  if (RealPart(ksAccum[1]) < 1.0e-15){
+    printf("Error: Evaluate the functions before derivatives \n");
+  }
+
+  TACSStochasticElement *selem = dynamic_cast<TACSStochasticElement*>(element);
+  if (!selem) {
+    printf("Casting to stochastic element failed; skipping elemenwiseEval");
+  };
+
+  TACSElement *delem = selem->getDeterministicElement();
+  const int nsparams = pc->getNumParameters();
+  const int nddof    = delem->getNumVariables();
+  const int nsdof    = selem->getNumVariables();
+  memset(dfdu, 0, nsdof*sizeof(TacsScalar));
+
+  // Scratch arrays are taken from the workspace of this thread
+  TACSStochasticWorkspace::Frame work;
+
+  // Space for quadrature points and weights
+  TacsScalar *zq = work.allocate(nsparams);
+  TacsScalar *yq = work.allocate(nsparams);
+
+  // Deterministic states at every quadrature node in y, reconstructed
+  // from the stochastic states in one product
+  TacsScalar *uc     = work.allocate(3*nsqpts*nddof);
+  const TacsScalar *vecs[3] = {v, dv, ddv};
+  selem->getDeterministicStates(0, nsqpts, 3, vecs, uc);
+
+  // Point sensitivities at every quadrature node, projected on all the
+  // basis terms together after the sweep
+  TacsScalar *dfduq  = work.allocate(nsqpts*nddof);
+  memset(dfduq, 0, nsqpts*nddof*sizeof(TacsScalar));
+
+  // Stochastic Integration
+  for (int q = 0; q < nsqpts; q++){
+
+    // Get the quadrature points and weights for mean
+    pc->quadrature(q, zq, yq);
+
+    // Set the parameter values into the element
+    TACSElement *qelem = selem->getParameterizedElement(q, delem, yq);
+
+    // Form the state vectors
+    const TacsScalar *uq   = &uc[3*q*nddof];
+    const TacsScalar *udq  = &uq[nddof];
+    const TacsScalar *uddq = &uq[2*nddof];
+
+    const TacsScalar dfdf = getPointSens(q);
+
+    integrateElement(delem, Xpts, [&]( int n, double pt[], TacsScalar weight ){
+        TacsScalar quantity = 0.0;
+        qelem->evalPointQuantity(elemIndex,
+                                 this->quantityType,
+                                 time, n, pt,
+                                 Xpts, uq, udq, uddq,
+                                 &quantity);
+
+        TacsScalar ksPtWeight = weight*exp(ksWeight*quantity - ksAccum[2*q])/ksAccum[2*q+1];
+        if (elementQuadrature){
+          TacsScalar dfdq = ksPtWeight*dfdf;
+          qelem->addPointQuantitySVSens(elemIndex,
+                                        this->quantityType,
+                                        time,
+                                        alpha, beta, gamma,
+                                        n, pt,
+                                        Xpts, uq, udq, uddq,
+                                        &dfdq, &dfduq[q*nddof]);
+        } else {
+          TacsScalar dfdq = ksPtWeight;
+          qelem->addPointQuantitySVSens(elemIndex,
+                                        this->quantityType,
+                                        time,
+                                        alpha*ksPtWeight*dfdf,
+                                        beta*ksPtWeight*dfdf,
+                                        gamma*ksPtWeight*dfdf,
+                                        n, pt,
+                                        Xpts, uq, udq, uddq,
+                                        &dfdq, &dfduq[q*nddof]);
+        }
+      });
+
+  } // probabilistic integration
+
+  // Weight with w_q psi_j(z_q) and place into the stochastic array
+  selem->addProjectedVectors(0, nsqpts, dfduq, dfdu);
+}
+
+void TACSKSStochasticAggregate::addElementDVSens( int elemIndex, TACSElement *element,
+                                                  double time, TacsScalar scale,
+                                                  const TacsScalar Xpts[],
+                                                  const TacsScalar v[],
+                                                  const TacsScalar dv[],
+                                                  const TacsScalar ddv[],
+                                                  int dvLen,
+                                                  TacsScalar dfdx[] ){
+  finishEvaluation();
+
+  TACSStochasticElement *selem = dynamic_cast<TACSStochasticElement*>(element);
+  if (!selem) {
+    printf("Casting to stochastic element failed; skipping elemenwiseEval");
+  };
+  TACSElement *delem  = selem->getDeterministicElement();
+
+  const int nsparams  = pc->getNumParameters();
+  const int nddof     = delem->getNumVariables();
+
+  // Scratch arrays are taken from the workspace of this thread
+  TACSStochasticWorkspace::Frame work;
+
+  // j-th projection of dfdx array
+  TacsScalar *dfdxj  = work.allocate(dvLen);
+  memset(dfdxj, 0, dvLen*sizeof(TacsScalar));
+
+  // Space for quadrature points and weights
+  TacsScalar *zq = work.allocate(nsparams);
+  TacsScalar *yq = work.allocate(nsparams);
+
+  // Deterministic states at every quadrature node in y, reconstructed
+  // from the stochastic states in one product
+  TacsScalar *uc     = work.allocate(3*nsqpts*nddof);
+  const TacsScalar *vecs[3] = {v, dv, ddv};
+  selem->getDeterministicStates(0, nsqpts, 3, vecs, uc);
+
+  // Stochastic Integration
+  for (int q = 0; q < nsqpts; q++){
+
+    // Get the quadrature points and weights for mean
+    TacsScalar wq = pc->quadrature(q, zq, yq);
+    TacsScalar wt = pc->basis(0,zq)*wq;
+
+    // Set the parameter values into the element
+    TACSElement *qelem = selem->getParameterizedElement(q, delem, yq);
+
+    // form deterministic states
+    const TacsScalar *uq   = &uc[3*q*nddof];
+    const TacsScalar *udq  = &uq[nddof];
+    const TacsScalar *uddq = &uq[2*nddof];
+
+    const TacsScalar dfdf = getPointSens(q);
+
+    integrateElement(delem, Xpts, [&]( int n, double pt[], TacsScalar weight ){
+        TacsScalar quantity = 0.0;
+        qelem->evalPointQuantity(elemIndex,
+                                 this->quantityType,
+                                 time, n, pt,
+                                 Xpts, uq, udq, uddq,
+                                 &quantity);
+
+        // Call the underlying element and get the design variable sensitivities
+        TacsScalar ksPtWeight = weight*exp(ksWeight*quantity - ksAccum[2*q])/ksAccum[2*q+1];
+        if (elementQuadrature){
+          TacsScalar dfdq = ksPtWeight*wt*dfdf;
+          qelem->addPointQuantityDVSens( elemIndex,
+                                         this->quantityType,
+                                         time, scale,
+                                         n, pt,
+                                         Xpts, uq, udq, uddq, &dfdq,
+                                         dvLen, dfdxj );
+        } else {
+          TacsScalar dfdq = ksPtWeight;
+          qelem->addPointQuantityDVSens( elemIndex,
+                                         this->quantityType,
+                                         time, ksPtWeight*wt*scale*dfdf,
+                                         n, pt,
+                                         Xpts, uq, udq, uddq, &dfdq,
+                                         dvLen, dfdxj );
+        }
+      });
+
+  } // end yloop
+
+  // need to be careful with nodewise placement of dvsx
+  for (int n = 0; n < dvLen; n++){
+    dfdx[n] += dfdxj[n];
+  }
+}
@@ -0,0 +1,239 @@
+#ifndef TACS_KSSTOCHASTIC_AGGREGATE
+#define TACS_KSSTOCHASTIC_AGGREGATE
+
+#include "TACSFunction.h"
+#include "ParameterContainer.h"
+#include "TACSStochasticReduction.h"
+
+/**
+   Statistics of the KS aggregate f(y) of a quantity over the domain,
+   shared by the KS stochastic functions.
+
+   The KS value at every stochastic quadrature point is accumulated
+   from a streaming log-sum-exp and reduced over the processors in one
+   collective. The derived functions only define the statistic of the
+   values f_q and its derivative w.r.t. each f_q, and the state and
+   design sensitivities are swept over the points here.
+
+   With the element quadrature, the quantity is integrated over the
+   quadrature points of the element basis and the derivative is passed
+   to the element in dfdq. Otherwise the quantity is evaluated at a
+   single point of the element and the derivative scales the alpha,
+   beta, gamma and scale coefficients.
+*/
+class TACSKSStochasticAggregate : public TACSFunction {
+ public:
+  TACSKSStochasticAggregate( TACSAssembler *tacs,
+                             TACSFunction *dfunc,
+                             ParameterContainer *pc,
+                             int quantityType,
+                             int moment_type,
+                             double ksWeight,
+                             int elementQuadrature );
+  ~TACSKSStochasticAggregate();
+
+  // Overlap the reductions over the processors with the next function
+  void setNonblockingReduction( int flag );
+
+  /**
+     Get the object name
+  */
+  const char *getObjectName(){
+    return this->dfunc->getObjectName();
+  }
+
+  /**
+     Get the type of integration domain
+
+     @return The enum type of domain
+  */
+  DomainType getDomainType(){
+    return this->dfunc->getDomainType();
+  }
+
+  /**
+     Get the stage type of this function: Either one or two stage
+
+     Some functions (such as aggregation functionals) require a
+     two-stage integration strategy for numerical stability.
+
+     The KS aggregate is accumulated with a streaming log-sum-exp that
+     tracks the maximum as it goes, so a single stage is enough.
+
+     @return The enum type indicating whether this is a one or two stage func.
+  */
+  StageType getStageType(){
+    return TACSFunction::SINGLE_STAGE;
+  }
+
+  /**
+     Retrieve the element domain from the function
+
+     @param elemNums The element numbers defining the domain
+     @return The numer of elements in the domain
+  */
+  int getElementNums( const int **_elemNums ){
+    return this->dfunc->getElementNums(_elemNums);
+  }
+
+  /**
+     Return the TACSAssembler object associated with this function
+  */
+  TACSAssembler *getAssembler(){
+    return this->dfunc->getAssembler();
+  }
+
+  /**
+     Initialize the function for the given type of evaluation
+
+     This call is collective on all processors in the assembler.
+  */
+  void initEvaluation( EvaluationType ftype );
+
+  /**
+     Perform an element-wise integration over this element.
+
+     Note that this is not a collective call and should be called once
+     for each element within the integration domain.
+
+     @param ftype The type of evaluation
+     @param elemIndex The local element index
+     @param element The TACSElement object
+     @param time The simulation time
+     @param scale The scalar integration factor to apply
+     @param Xpts The element node locations
+     @param vars The element DOF
+     @param dvars The first time derivatives of the element DOF
+     @param ddvars The second time derivatives of the element DOF
+  */
+  void elementWiseEval( EvaluationType ftype,
+                        int elemIndex, TACSElement *element,
+                        double time,
+                        TacsScalar scale,
+                        const TacsScalar Xpts[],
+                        const TacsScalar vars[],
+                        const TacsScalar dvars[],
+                        const TacsScalar ddvars[] );
+  /**
+     Finalize the function evaluation for the specified eval type.
+
+     This call is collective on all processors in the assembler.
+  */
+  void finalEvaluation( EvaluationType ftype );
+
+  /**
+     Evaluate the derivative of the function w.r.t. state variables
+
+     @param elemIndex The local element index
+     @param element The TACSElement object
+     @param time The simulation time
+     @param alpha Coefficient for the DOF derivative
+     @param beta Coefficient for the first time DOF derivative
+     @param gamma Coefficient for the second time DOF derivative
+     @param Xpts The element node locations
+     @param vars The element DOF
+     @param dvars The first time derivatives of the element DOF
+     @param ddvars The second time derivatives of the element DOF
+  */
+  void getElementSVSens( int elemIndex, TACSElement *element,
+                         double time,
+                         TacsScalar alpha, TacsScalar beta,
+                         TacsScalar gamma,
+                         const TacsScalar Xpts[],
+                         const TacsScalar vars[],
+                         const TacsScalar dvars[],
+                         const TacsScalar ddvars[],
+                         TacsScalar dfdu[] );
+
+  /**
+     Add the derivative of the function w.r.t. the design variables
+
+     The design variables *must* be the same set of variables defined
+     in the element. The TACSFunction class cannot define new design
+     variables!
+
+     @param elemIndex The local element index
+     @param element The TACSElement object
+     @param time The simulation time
+     @param Xpts The element node locations
+     @param vars The element DOF
+     @param dvars The first time derivatives of the element DOF
+     @param ddvars The second time derivatives of the element DOF
+  */
+  void addElementDVSens( int elemIndex, TACSElement *element,
+                         double time, TacsScalar scale,
+                         const TacsScalar Xpts[],
+                         const TacsScalar vars[],
+                         const TacsScalar dvars[],
+                         const TacsScalar ddvars[],
+                         int dvLen,
+                         TacsScalar dfdx[] );
+  /**
+     Evaluate the derivative of the function w.r.t. the node locations
+
+     @param elemIndex The local element index
+     @param element The TACSElement object
+     @param time The simulation time
+     @param scale The scalar integration factor to apply
+     @param Xpts The element node locations
+     @param vars The element DOF
+     @param dvars The first time derivatives of the element DOF
+     @param ddvars The second time derivatives of the element DOF
+  */
+  virtual void getElementXptSens( int elemIndex, TACSElement *element,
+                                  double time, TacsScalar scale,
+                                  const TacsScalar Xpts[],
+                                  const TacsScalar vars[],
+                                  const TacsScalar dvars[],
+                                  const TacsScalar ddvars[],
+                                  TacsScalar dfdXpts[] ){
+    int numNodes = element->getNumNodes();
+    memset(dfdXpts, 0, 3*numNodes*sizeof(TacsScalar));
+  }
+
+ protected:
+
+  TACSFunction *dfunc;
+  ParameterContainer *pc;
+
+  // Integer identifying the function type
+  int quantityType;
+
+  // The value of the KS weight
+  double ksWeight;
+
+  // Intermediate values in the functional evaluation: the pair
+  // (ksWeight*max, sum) at each quadrature point, and the KS values
+  TacsScalar *ksAccum;
+  TacsScalar *fvals;
+
+  int moment_type;
+
+  // number of stochastic quadrature points
+  int nsqpts;
+  int nsterms;
+
+  // Complete the reduction and form the KS values at the points
+  void finishEvaluation();
+
+  // Derivative of the statistic w.r.t. the KS value at a quadrature point
+  virtual TacsScalar getPointSens( int q ) = 0;
+
+ private:
+
+  // Integrate over the quadrature of the element basis, or evaluate
+  // the quantity at a single point
+  int elementQuadrature;
+  template <class Point>
+  void integrateElement( TACSElement *delem, const TacsScalar Xpts[],
+                         Point point );
+
+  MPI_Comm tacs_comm;
+
+  // Reduction of the KS buffers, and whether the KS values at the
+  // quadrature points await its completion
+  TACSStochasticReduction *reduction;
+  int ks_pending;
+};
+
+#endif
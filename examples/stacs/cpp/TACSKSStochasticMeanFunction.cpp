@@ -0,0 +1,77 @@
+#include "TACSKSStochasticMeanFunction.h"
+
+TACSKSStochasticMeanFunction::TACSKSStochasticMeanFunction( TACSAssembler *tacs,
+                                                            TACSFunction *dfunc,
+                                                            ParameterContainer *pc,
+                                                            int quantityType,
+                                                            int moment_type,
+                                                            double ksWeight,
+                                                            int power )
+  : TACSKSStochasticAggregate(tacs, dfunc, pc, quantityType,
+                              moment_type, ksWeight, 0)
+{
+  this->power = power;
+}
+
+/**
+   Get the value of the function
+*/
+TacsScalar TACSKSStochasticMeanFunction::getFunctionValue(){  
+  return getExpectation();
+}
+
+/*
+  Return the expectation E[f^power] of the KS value
+*/
+TacsScalar TACSKSStochasticMeanFunction::getExpectation(){
+  finishEvaluation();
+  const TacsScalar *wpsi0 = pc->getWeightedBasisRow(0);
+  TacsScalar fmean = 0.0;
+  for (int q = 0; q < nsqpts; q++){
+    TacsScalar fq = fvals[q];
+    for (int m = 1; m < power; m++){
+      fq *= fvals[q];
+    }
+    fmean += wpsi0[q]*fq;
+  }
+  return fmean;
+}
+
+/*
+  Return the variance of the projection of the KS value, the sum of
+  the squares of its projections on the basis terms other than the
+  mean
+*/
+TacsScalar TACSKSStochasticMeanFunction::getVariance(){
+  finishEvaluation();
+  TacsScalar fvar = 0.0;
+  for (int k = 1; k < nsterms; k++){
+    TacsScalar fk = getProjection(k);
+    fvar += fk*fk;
+  }
+  return fvar;
+}
+
+/*
+  Projection of the KS values on the k-th basis term,
+  f_k = sum_q w_q psi_k(z_q) f_q
+*/
+TacsScalar TACSKSStochasticMeanFunction::getProjection( int k ){
+  const TacsScalar *wpsik = pc->getWeightedBasisRow(k);
+  TacsScalar fk = 0.0;
+  for (int q = 0; q < nsqpts; q++){
+    fk += wpsik[q]*fvals[q];
+  }
+  return fk;
+}
+
+/*
+  Derivative of f^power w.r.t. the KS value at the quadrature point q
+*/
+TacsScalar TACSKSStochasticMeanFunction::getPointSens( int q ){
+  TacsScalar dfdf = power;
+  for (int m = 1; m < power; m++){
+    dfdf *= fvals[q];
+  }
+  return dfdf;
+}
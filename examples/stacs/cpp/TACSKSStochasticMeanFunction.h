@@ -0,0 +1,42 @@
+#ifndef TACS_KSSTOCHASTIC_MEAN_FUNCTION
+#define TACS_KSSTOCHASTIC_MEAN_FUNCTION
+
+#include "TACSKSStochasticAggregate.h"
+
+/**
+   Expectation E[f^power] of the KS aggregate f(y) of a quantity
+   evaluated at a single point of each element, shared by the KS mean
+   (power 1) and second moment (power 2) functions.
+*/
+class TACSKSStochasticMeanFunction : public TACSKSStochasticAggregate {
+ public:
+  TACSKSStochasticMeanFunction( TACSAssembler *tacs,
+                                TACSFunction *dfunc,
+                                ParameterContainer *pc,
+                                int quantityType,
+                                int moment_type,
+                                double ksWeight,
+                                int power );
+
+  // New functions
+  TacsScalar getExpectation();
+  TacsScalar getVariance();
+
+  /**
+     Get the value of the function
+  */
+  TacsScalar getFunctionValue();
+
+ protected:
+  // Derivative of f^power w.r.t. the KS value at a quadrature point
+  TacsScalar getPointSens( int q );
+
+ private:
+  // Power of the KS value whose expectation is taken
+  int power;
+
+  // Projection of the KS values on the k-th basis term
+  TacsScalar getProjection( int k );
+};
+
+#endif
@@ -1,7 +1,8 @@
 #include "TACSMutableElement3D.h"
 
 // Constructor
-TACSMutableElement3D::TACSMutableElement3D( TACSElement *_elem ){
+TACSMutableElement3D::TACSMutableElement3D( TACSElement *_elem )
+  : TACSParameterizedElement(1){
   this->element = _elem;
   this->element->incref();
 }
@@ -28,3 +29,10 @@ void TACSMutableElement3D::setDensity( TacsScalar _rho ){
   props[0]->setDensity(_rho);
 }
 
+// Setter for the random fields
+void TACSMutableElement3D::setRandomParameters( const TacsScalar y[] ){
+  int pid = getParameterMap(DENSITY);
+  if (pid >= 0){
+    setDensity(y[pid]);
+  }
+}
@@ -7,14 +7,19 @@
 #define TACS_MUTABLE_ELEMENT_H
 
 #include "TACSElement.h"
+#include "TACSParameterizedElement.h"
 #include "TACSElementModel.h"
 #include "TACSElementBasis.h"
 #include "TMROctConstitutive.h"
 #include "TACSLinearElasticity.h"
 #include "TACSMaterialProperties.h"
 
-class TACSMutableElement3D : public TACSElement {
+class TACSMutableElement3D : public TACSElement,
+                             public TACSParameterizedElement {
  public:
+  // Fields that may be random
+  enum RandomField { DENSITY = 0 };
+
   TACSMutableElement3D( TACSElement *_elem );
   ~TACSMutableElement3D();
 
@@ -23,6 +28,18 @@ class TACSMutableElement3D : public TACSElement {
   */
   void setDensity( TacsScalar _rho );
 
+  /**
+     Set the random density
+  */
+  void setRandomParameters( const TacsScalar y[] );
+
+  /**
+     The jacobian is linear in the density (through the mass matrix)
+  */
+  int getFieldDegree( int field ){
+    return 1;
+  }
+
   /**
      Set the component number for this element.
 
@@ -0,0 +1,101 @@
+#include "TACSParameterizedElement.h"
+
+/*
+  Constructor with every field deterministic
+
+  @param nfields the number of fields that may be random
+*/
+TACSParameterizedElement::TACSParameterizedElement( int _nfields ){
+  this->nfields = _nfields;
+  this->field_pids = new int[nfields];
+  for (int f = 0; f < nfields; f++){
+    field_pids[f] = -1;
+  }
+}
+
+/*
+  Destructor
+*/
+TACSParameterizedElement::~TACSParameterizedElement(){
+  delete [] this->field_pids;
+}
+
+/*
+  Return the polynomial degree of the element jacobian in a field, -1
+  when unknown
+
+  @param field the field of the element
+*/
+int TACSParameterizedElement::getFieldDegree( int field ){
+  return -1;
+}
+
+/*
+  Declare the parameter that drives a field of the element
+
+  @param field the field of the element
+  @param pid the parameter ID in the container, -1 for deterministic
+*/
+void TACSParameterizedElement::setParameterMap( int field, int pid ){
+  if (field < 0 || field >= nfields){
+    printf("Error: Random field %d out of range [0, %d)\n", field, nfields);
+    return;
+  }
+  this->field_pids[field] = pid;
+}
+
+/*
+  Return the parameter that drives a field, -1 when deterministic
+
+  @param field the field of the element
+*/
+int TACSParameterizedElement::getParameterMap( int field ){
+  return this->field_pids[field];
+}
+
+/*
+  Return the number of fields that may be random
+*/
+int TACSParameterizedElement::getNumRandomFields(){
+  return this->nfields;
+}
+
+/*
+  Return the number of fields driven by a parameter
+*/
+int TACSParameterizedElement::getNumMappedFields(){
+  int nmapped = 0;
+  for (int f = 0; f < nfields; f++){
+    if (field_pids[f] >= 0){
+      nmapped++;
+    }
+  }
+  return nmapped;
+}
+
+/*
+  Return the polynomial degree of the element jacobian in each
+  parameter, the sum of the degrees of the fields it drives. Parameters
+  that drive no field enter with degree zero.
+
+  @param nparams the number of parameters
+  @param pdeg returns the degree in each parameter
+  @return 0 when the degrees are known, 1 otherwise
+*/
+int TACSParameterizedElement::getParameterDegrees( int nparams, int pdeg[] ){
+  for (int p = 0; p < nparams; p++){
+    pdeg[p] = 0;
+  }
+  for (int f = 0; f < nfields; f++){
+    const int pid = field_pids[f];
+    if (pid < 0){
+      continue;
+    }
+    const int deg = getFieldDegree(f);
+    if (pid >= nparams || deg < 0){
+      return 1;
+    }
+    pdeg[pid] += deg;
+  }
+  return 0;
+}
@@ -0,0 +1,60 @@
+/*
+  Interface for deterministic elements whose attributes are random
+  parameters of the stochastic problem
+*/
+
+#ifndef TACS_PARAMETERIZED_ELEMENT_H
+#define TACS_PARAMETERIZED_ELEMENT_H
+
+#include "TACSObject.h"
+
+/**
+   Native binding of the random parameters to the attributes (fields)
+   of a deterministic element.
+
+   An element implementing this interface numbers its random fields
+   (mass, density, stiffness, ...) and sets them from the parameter
+   values in setRandomParameters(). The parameter driving each field is
+   declared with setParameterMap(), so the stochastic element updates
+   the element at each quadrature point with a virtual call instead of
+   a callback into the interpreter. Fields without a parameter keep
+   their deterministic values. An element with no mapped field is
+   updated through the callback of the stochastic element instead.
+*/
+class TACSParameterizedElement {
+ public:
+  TACSParameterizedElement( int nfields );
+  virtual ~TACSParameterizedElement();
+
+  /**
+     Set the random fields of the element from the parameter values
+
+     @param y the values of all parameters at the quadrature point
+  */
+  virtual void setRandomParameters( const TacsScalar y[] ) = 0;
+
+  /**
+     Polynomial degree of the element jacobian in a field, or -1 when
+     the jacobian is not a polynomial in the field (the default). The
+     stochastic element skips the Galerkin blocks that vanish for the
+     declared degrees.
+
+     @param field the field of the element
+  */
+  virtual int getFieldDegree( int field );
+
+  // Declare the parameter that drives a field
+  void setParameterMap( int field, int pid );
+  int getParameterMap( int field );
+  int getNumRandomFields();
+  int getNumMappedFields();
+
+  // Degree of the jacobian in each parameter
+  int getParameterDegrees( int nparams, int pdeg[] );
+
+ private:
+  int nfields;
+  int *field_pids;  // parameter of each field, -1 when deterministic
+};
+
+#endif
@@ -1,25 +1,11 @@
 #include "TACSStochasticElement.h"
+#include "MatrixKernels.h"
 
-namespace{
-  /*
-    Predetermine whether the jacobian block is nonzero
-  */
-  bool nonzero(const int nvars, int *dmapi, int *dmapj, int *dmapk){
-    int filter[nvars];
-    for( int i = 0; i < nvars; i++ ){
-      if (abs(dmapi[i] - dmapj[i]) <= dmapk[i]){
-        filter[i] = 1;
-      } else {
-        filter[i] = 0;
-      }
-    }
-    int prod = 1;
-    for( int i = 0; i < nvars; i++ ){
-      prod *= filter[i];
-    }
-    return prod;
-  }
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
+namespace{
   /*
     Place entry into the matrix location
   */
@@ -51,75 +37,70 @@ namespace{
     }
   }
 
-  void getDeterministicAdjoint( ParameterContainer *pc, 
-                                TACSElement *delem,
-                                TACSElement *selem, 
-                                const TacsScalar v[],
-                                TacsScalar *zq,
-                                TacsScalar *uq
-                                ){
-    int ndvpn   = delem->getVarsPerNode();
-    int nsvpn   = selem->getVarsPerNode();
-    int nddof   = delem->getNumVariables();
-    int nsdof   = selem->getNumVariables();
-    int nsterms = pc->getNumBasisTerms();
-    int nnodes  = selem->getNumNodes();
-    
-    memset(uq  , 0, nddof*sizeof(TacsScalar));
-
-    // Evaluate the basis at quadrature node and form the state
-    // vectors
-    for (int n = 0; n < nnodes; n++){
-      for (int k = 0; k < nsterms; k++){
-        TacsScalar psikz = pc->basis(k,zq);
-        int lptr = n*ndvpn;
-        int gptr = n*nsvpn + k*ndvpn;
-        for (int d = 0; d < ndvpn; d++){        
-          uq[lptr+d] += v[gptr+d]*psikz;
+  /*
+    Gather the nodal variables of every basis term into a termwise
+    matrix, vt[k*ldt + n*ndvpn + d] = v[n*nsvpn + k*ndvpn + d]
+  */
+  void gatherTermwise( int nnodes, int nsterms, int ndvpn,
+                       const TacsScalar v[], TacsScalar *vt, int ldt ){
+    const int nsvpn = nsterms*ndvpn;
+    for (int k = 0; k < nsterms; k++){
+      for (int n = 0; n < nnodes; n++){
+        const TacsScalar *vn = &v[n*nsvpn + k*ndvpn];
+        TacsScalar *vtn = &vt[k*ldt + n*ndvpn];
+        for (int d = 0; d < ndvpn; d++){
+          vtn[d] = vn[d];
         }
       }
     }
-  } 
-
-  void getDeterministicStates( ParameterContainer *pc, 
-                               TACSElement *delem,
-                               TACSElement *selem, 
-                               const TacsScalar v[],
-                               const TacsScalar dv[],
-                               const TacsScalar ddv[], 
-                               TacsScalar *zq,
-                               TacsScalar *uq,
-                               TacsScalar *udq,
-                               TacsScalar *uddq
-                               ){
-    int ndvpn   = delem->getVarsPerNode();
-    int nsvpn   = selem->getVarsPerNode();
-    int nddof   = delem->getNumVariables();
-    int nsdof   = selem->getNumVariables();
-    int nsterms = pc->getNumBasisTerms();
-    int nnodes  = selem->getNumNodes();
-
-    memset(uq  , 0, nddof*sizeof(TacsScalar));
-    memset(udq , 0, nddof*sizeof(TacsScalar));
-    memset(uddq, 0, nddof*sizeof(TacsScalar));
-
-    // Evaluate the basis at quadrature node and form the state
-    // vectors
-    for (int n = 0; n < nnodes; n++){
-      for (int k = 0; k < nsterms; k++){
-        TacsScalar psikz = pc->basis(k,zq);
-        int lptr = n*ndvpn;
-        int gptr = n*nsvpn + k*ndvpn;
-        for (int d = 0; d < ndvpn; d++){        
-          uq[lptr+d] += v[gptr+d]*psikz;
-          udq[lptr+d] += dv[gptr+d]*psikz;
-          uddq[lptr+d] += ddv[gptr+d]*psikz;
+  }
+
+  /*
+    Add a termwise matrix into the nodal variables of every basis term,
+    the reverse of gatherTermwise
+  */
+  void scatterTermwise( int nnodes, int nsterms, int ndvpn,
+                        const TacsScalar *vt, int ldt, TacsScalar v[] ){
+    const int nsvpn = nsterms*ndvpn;
+    for (int k = 0; k < nsterms; k++){
+      for (int n = 0; n < nnodes; n++){
+        const TacsScalar *vtn = &vt[k*ldt + n*ndvpn];
+        TacsScalar *vn = &v[n*nsvpn + k*ndvpn];
+        for (int d = 0; d < ndvpn; d++){
+          vn[d] += vtn[d];
         }
       }
     }
-  } 
+  }
+
+  /*
+    Values at the quadrature points [qstart, qstart+npts) from the
+    termwise coefficients as one product with the basis table,
+    uq (npts x ncols) = Psi (npts x nsterms) * vt (nsterms x ncols)
+  */
+  void reconstruct( ParameterContainer *pc, int qstart, int npts,
+                    int ncols, const TacsScalar *vt, TacsScalar *uq ){
+    int ldq, ldk;
+    pc->getBasisTableStrides(&ldq, &ldk);
+    MatrixKernels::gemm(0, 0, npts, ncols, pc->getNumBasisTerms(), 1.0,
+                        pc->getBasisColumn(qstart), ldk, vt, ncols,
+                        0.0, uq, ncols);
+  }
 
- 
+  /*
+    Add the projection of the values at the quadrature points [qstart,
+    qstart+npts) onto the basis terms as one product with the weighted
+    basis table, ft (nsterms x ncols) += W Psi^T (nsterms x npts) * fq
+    (npts x ncols)
+  */
+  void project( ParameterContainer *pc, int qstart, int npts,
+                int ncols, const TacsScalar *fq, TacsScalar *ft ){
+    int ldq, ldk;
+    pc->getBasisTableStrides(&ldq, &ldk);
+    MatrixKernels::gemm(0, 0, pc->getNumBasisTerms(), ncols, npts, 1.0,
+                        &pc->getWeightedBasisRow(0)[qstart], ldq, fq, ncols,
+                        1.0, ft, ncols);
+  }
 }
 
 TACSStochasticElement::TACSStochasticElement( TACSElement *_delem,
@@ -131,6 +112,7 @@ TACSStochasticElement::TACSStochasticElement( TACSElement *_delem,
 
   // Set callback for element update
   update = _update;
+  pyptr = NULL;
 
   // Set the component numner of this element
   setComponentNum(delem->getComponentNum());
@@ -141,14 +123,653 @@ TACSStochasticElement::TACSStochasticElement( TACSElement *_delem,
   // Set number of dofs
   num_nodes     = delem->getNumNodes();
   vars_per_node = pc->getNumBasisTerms()*delem->getVarsPerNode();
+
+  // Size of the scratch arrays of the largest kernel (termwise states
+  // and residuals, vectors at a chunk of quadrature points and the
+  // jacobian of a point), padded for alignment of each array
+  const int nddof    = delem->getNumVariables();
+  const int nsterms  = pc->getNumBasisTerms();
+  const int nsparams = pc->getNumParameters();
+  const int nchunk   = pc->getQuadratureChunkSize();
+  work_size = 2*nsparams + 5*nsterms*nddof + 5*nchunk*nddof
+    + nddof*nddof + 8*16;
+
+  // Quadrature loops run serially on the deterministic element
+  nthreads = 1;
+  thread_elems = new TACSElement*[1];
+  thread_elems[0] = delem;
+
+  // No cache of parameterized elements
+  num_qelems = 0;
+  qelems = NULL;
+
+  // Jacobian integrated on the full grid
+  block_quadrature = 0;
 }
 
 TACSStochasticElement::~TACSStochasticElement(){
+  for (int t = 1; t < nthreads; t++){
+    thread_elems[t]->decref();
+  }
+  delete [] thread_elems;
+  setQuadratureElements(0, NULL);
   this->delem->decref();
   this->delem = NULL;
   this->pc = NULL;
 }
 
+/*
+  Run the quadrature loops on several threads. Each thread takes a
+  contiguous range of quadrature points and updates its own copy of the
+  deterministic element, so the clones must be independent instances
+  equivalent to the deterministic element (same dofs and attributes).
+  The update callback must be safe to call from several threads.
+
+  @param _nthreads the number of threads
+  @param clones the nthreads-1 copies of the deterministic element
+*/
+void TACSStochasticElement::setNumThreads( int _nthreads,
+                                           TACSElement **clones ){
+#ifndef _OPENMP
+  if (_nthreads > 1){
+    printf("Warning: Stochastic element built without OpenMP, "
+           "using one thread\n");
+    _nthreads = 1;
+  }
+#endif
+  if (_nthreads > 1 && !clones){
+    printf("Error: Threaded stochastic element needs %d element clones, "
+           "using one thread\n", _nthreads-1);
+    _nthreads = 1;
+  }
+  if (_nthreads < 1){
+    _nthreads = 1;
+  }
+
+  // Take the new clones before releasing the old ones
+  TACSElement **elems = new TACSElement*[_nthreads];
+  elems[0] = delem;
+  for (int t = 1; t < _nthreads; t++){
+    elems[t] = clones[t-1];
+    elems[t]->incref();
+  }
+  for (int t = 1; t < nthreads; t++){
+    thread_elems[t]->decref();
+  }
+  delete [] thread_elems;
+  thread_elems = elems;
+  nthreads = _nthreads;
+}
+
+/*
+  Returns the number of threads running the quadrature loops
+*/
+int TACSStochasticElement::getNumThreads(){
+  return nthreads;
+}
+
+/*
+  Keep one deterministic element per quadrature point, parameterized
+  once here, so that the quadrature loops swap elements instead of
+  updating the parameters of one element at every point. The elements
+  must be independent instances equivalent to the deterministic
+  element. This trades memory for the cost of rebuilding the
+  parameter-dependent data (constitutive properties) of the element at
+  every point, iteration and time step. Pass zero elements to drop the
+  cache.
+
+  @param nqpts the number of quadrature points of the container
+  @param _qelems the element for each quadrature point
+*/
+void TACSStochasticElement::setQuadratureElements( int nqpts,
+                                                   TACSElement **_qelems ){
+  if (nqpts > 0 && nqpts != pc->getNumQuadraturePoints()){
+    printf("Error: Expected %d quadrature elements, got %d\n",
+           pc->getNumQuadraturePoints(), nqpts);
+    return;
+  }
+
+  for (int q = 0; q < num_qelems; q++){
+    qelems[q]->decref();
+  }
+  if (qelems){
+    delete [] qelems;
+  }
+  num_qelems = 0;
+  qelems = NULL;
+  if (nqpts <= 0){
+    return;
+  }
+
+  // Parameterize each element at its quadrature point
+  const int nsparams = pc->getNumParameters();
+  TacsScalar *zq = new TacsScalar[nsparams];
+  TacsScalar *yq = new TacsScalar[nsparams];
+  num_qelems = nqpts;
+  qelems = new TACSElement*[nqpts];
+  for (int q = 0; q < nqpts; q++){
+    qelems[q] = _qelems[q];
+    qelems[q]->incref();
+    pc->quadrature(q, zq, yq);
+    updateElement(qelems[q], yq);
+  }
+  delete [] zq;
+  delete [] yq;
+}
+
+/*
+  Return the deterministic element parameterized at a quadrature
+  point: the cached element of the point when available, otherwise
+  elem updated with the parameter values
+
+  @param q the quadrature point
+  @param elem the element to update when there is no cache
+  @param yq the parameter values at the quadrature point
+*/
+TACSElement* TACSStochasticElement::getParameterizedElement( int q,
+                                                             TACSElement *elem,
+                                                             TacsScalar *yq ){
+  if (num_qelems > 0 && num_qelems == pc->getNumQuadraturePoints()){
+    return qelems[q];
+  }
+  updateElement(elem, yq);
+  return elem;
+}
+
+/*
+  Deterministic vectors at the quadrature points [qstart, qstart+npts)
+  reconstructed from stochastic vectors of this element, all at once
+  as one product with the basis table. Vector j at point p is stored
+  at uq[(p*nvecs + j)*nddof].
+
+  @param qstart the first quadrature point
+  @param npts the number of quadrature points
+  @param nvecs the number of stochastic vectors (e.g. v, dv, ddv)
+  @param vecs the stochastic vectors
+  @param uq the deterministic vectors (npts*nvecs*nddof)
+*/
+void TACSStochasticElement::getDeterministicStates( int qstart, int npts,
+                                                    int nvecs,
+                                                    const TacsScalar *vecs[],
+                                                    TacsScalar *uq ){
+  const int ndvpn   = delem->getVarsPerNode();
+  const int nddof   = delem->getNumVariables();
+  const int nsterms = pc->getNumBasisTerms();
+  const int nnodes  = this->getNumNodes();
+
+  TACSStochasticWorkspace::Frame work;
+  TacsScalar *vt = work.allocate(nsterms*nvecs*nddof);
+  for (int j = 0; j < nvecs; j++){
+    gatherTermwise(nnodes, nsterms, ndvpn, vecs[j], &vt[j*nddof], nvecs*nddof);
+  }
+  reconstruct(pc, qstart, npts, nvecs*nddof, vt, uq);
+}
+
+/*
+  Deterministic vectors of each basis term (the projections of the
+  stochastic vectors of this element), gathered from the nodewise
+  layout. Vector j of term k is stored at uk[(k*nvecs + j)*nddof].
+
+  @param nvecs the number of stochastic vectors (e.g. v, dv, ddv)
+  @param vecs the stochastic vectors
+  @param uk the deterministic vectors (nsterms*nvecs*nddof)
+*/
+void TACSStochasticElement::getCoefficientStates( int nvecs,
+                                                  const TacsScalar *vecs[],
+                                                  TacsScalar *uk ){
+  const int ndvpn   = delem->getVarsPerNode();
+  const int nddof   = delem->getNumVariables();
+  const int nsterms = pc->getNumBasisTerms();
+  const int nnodes  = this->getNumNodes();
+
+  for (int j = 0; j < nvecs; j++){
+    gatherTermwise(nnodes, nsterms, ndvpn, vecs[j], &uk[j*nddof], nvecs*nddof);
+  }
+}
+
+/*
+  Add the projection of deterministic vectors at the quadrature points
+  [qstart, qstart+npts) onto the basis terms into a stochastic vector
+  of this element, v_k += sum_q w_q psi_k(z_q) fq[q], as one product
+  with the weighted basis table. This is the transpose of
+  getDeterministicStates for the sensitivities of the functions.
+
+  @param qstart the first quadrature point
+  @param npts the number of quadrature points
+  @param fq the deterministic vectors (npts*nddof)
+  @param v the stochastic vector
+*/
+void TACSStochasticElement::addProjectedVectors( int qstart, int npts,
+                                                 const TacsScalar *fq,
+                                                 TacsScalar v[] ){
+  const int ndvpn   = delem->getVarsPerNode();
+  const int nddof   = delem->getNumVariables();
+  const int nsterms = pc->getNumBasisTerms();
+  const int nnodes  = this->getNumNodes();
+
+  TACSStochasticWorkspace::Frame work;
+  TacsScalar *ft = work.allocate(nsterms*nddof);
+  memset(ft, 0, nsterms*nddof*sizeof(TacsScalar));
+  project(pc, qstart, npts, nddof, fq, ft);
+  scatterTermwise(nnodes, nsterms, ndvpn, ft, nddof, v);
+}
+
+/*
+  Return the polynomial degree of the jacobian of the deterministic
+  element in each parameter, as declared by parameterized elements
+  that map their fields to the parameters
+
+  @param dmapf returns the degree in each parameter
+  @return 0 when the degrees are known, 1 otherwise (dense)
+*/
+int TACSStochasticElement::getJacobianDegrees( int *dmapf ){
+  TACSParameterizedElement *pelem =
+    dynamic_cast<TACSParameterizedElement*>(delem);
+  if (pelem && pelem->getNumMappedFields() > 0){
+    return pelem->getParameterDegrees(pc->getNumParameters(), dmapf);
+  }
+  return 1;
+}
+
+/*
+  Determine the (i,j) blocks of the stochastic jacobian that are
+  structurally nonzero. When the jacobian of the deterministic element
+  is a polynomial of degree dmapf[p] in each parameter, the projection
+  of psi_i*psi_j*A(y) vanishes whenever |deg_i(p) - deg_j(p)| > dmapf[p]
+  for some parameter, by orthogonality of the univariate polynomials.
+  Elements that do not declare their degrees are treated as dense.
+
+  @param nz returns nz[i*nsterms+j] = 1 for nonzero blocks (may be NULL)
+  @return the number of nonzero blocks
+*/
+int TACSStochasticElement::getBlockSparsity( int *nz ){
+  const int nsterms  = pc->getNumBasisTerms();
+  const int nsparams = pc->getNumParameters();
+
+  // Polynomial degree of the jacobian in each parameter
+  std::vector<int> dmapi(nsparams), dmapj(nsparams), dmapf(nsparams);
+  bool *filter = new bool[nsparams];
+  const int dense = getJacobianDegrees(dmapf.data());
+
+  BasisHelper bhelper;
+  int count = 0;
+  for (int i = 0; i < nsterms; i++){
+    pc->getBasisParamDeg(i, dmapi.data());
+    for (int j = 0; j < nsterms; j++){
+      int flag = 1;
+      if (!dense){
+        pc->getBasisParamDeg(j, dmapj.data());
+        bhelper.sparse(nsparams, dmapi.data(), dmapj.data(), dmapf.data(),
+                       filter);
+        for (int p = 0; p < nsparams; p++){
+          if (!filter[p]){
+            flag = 0;
+          }
+        }
+      }
+      if (nz){
+        nz[i*nsterms + j] = flag;
+      }
+      count += flag;
+    }
+  }
+  delete [] filter;
+
+  return count;
+}
+
+/*
+  Integrate each Galerkin block of the jacobian with the smallest
+  tensor rule that is exact for it, instead of the full quadrature
+  grid. With the declared degree dmapf[p] of the element jacobian, the
+  integrand psi_i*psi_j*A(y) of block (i,j) has degree deg_i(p) +
+  deg_j(p) + dmapf[p] in each parameter. Blocks needing the same rule
+  share the evaluations of the element jacobian on it, and low-order
+  blocks add the contributions of far fewer points. The residual is
+  taken from the same sweep on the single rule exact for all blocks
+  (the envelope), which is exact for it when the residual is linear
+  in the states.
+
+  The distinct rules together may hold more points than the envelope,
+  so the envelope is used for every block instead when it is cheaper,
+  costing an evaluation of the element jacobian as one block update.
+  Elements that declare no degrees always use the full grid.
+
+  @param flag 1 to select the quadrature per block, 0 for the full grid
+*/
+void TACSStochasticElement::setBlockQuadrature( int flag ){
+  this->block_quadrature = flag;
+}
+
+/*
+  Return the tensor rule with nqpts[p] Gauss points in each parameter
+  (or the coarsest nested rule as accurate), generated on first
+  access. Each point is stored as its parameter values, its weight and
+  the basis at the point, with the last parameter fastest. The rules
+  are cached by the quadrature rule and level of each parameter, so a
+  parameter that changes its rule gets a new one.
+
+  @param nqpts the number of Gauss points in each parameter
+*/
+const std::vector<TacsScalar>&
+TACSStochasticElement::getBlockRule( const std::vector<int> &nqpts ){
+  const int nsterms  = pc->getNumBasisTerms();
+  const int nsparams = pc->getNumParameters();
+  const int stride   = nsparams + 1 + nsterms;
+
+  // Rule and level of each parameter
+  std::vector<int> key(2*nsparams);
+  for (int p = 0; p < nsparams; p++){
+    AbstractParameter *param = pc->getParameter(p);
+    key[2*p]   = param->getQuadratureRule();
+    key[2*p+1] = param->getQuadratureLevel(nqpts[p]);
+  }
+
+  std::map<std::vector<int>, std::vector<TacsScalar> >::iterator it;
+  it = block_rules.find(key);
+  if (it != block_rules.end()){
+    return it->second;
+  }
+
+  // Univariate rules of each parameter
+  std::vector< std::vector<TacsScalar> > z(nsparams), y(nsparams), w(nsparams);
+  int npts = 1;
+  for (int p = 0; p < nsparams; p++){
+    AbstractParameter *param = pc->getParameter(p);
+    const int n = param->getQuadratureSize(key[2*p+1]);
+    z[p].resize(n);
+    y[p].resize(n);
+    w[p].resize(n);
+    param->quadrature(n, z[p].data(), y[p].data(), w[p].data());
+    npts *= n;
+  }
+
+  std::vector<TacsScalar> &rule = block_rules[key];
+  rule.resize(size_t(npts)*stride);
+  std::vector<TacsScalar> zq(nsparams);
+  std::vector<int> idx(nsparams, 0);
+  for (int q = 0; q < npts; q++){
+    TacsScalar *entry = &rule[size_t(q)*stride];
+    TacsScalar wq = 1.0;
+    for (int p = 0; p < nsparams; p++){
+      zq[p] = z[p][idx[p]];
+      entry[p] = y[p][idx[p]];
+      wq *= w[p][idx[p]];
+    }
+    entry[nsparams] = wq;
+    for (int k = 0; k < nsterms; k++){
+      entry[nsparams + 1 + k] = pc->basis(k, zq.data());
+    }
+
+    for (int p = nsparams-1; p >= 0; p--){
+      if (++idx[p] < (int)z[p].size()){
+        break;
+      }
+      idx[p] = 0;
+    }
+  }
+
+  return rule;
+}
+
+/*
+  Add the residual and the jacobian in one sweep, with each block of
+  the jacobian on its smallest exact rule and the residual on the
+  envelope, see setBlockQuadrature()
+*/
+void TACSStochasticElement::addBlockJacobian( int elemIndex,
+                                              double time,
+                                              TacsScalar alpha,
+                                              TacsScalar beta,
+                                              TacsScalar gamma,
+                                              const TacsScalar X[],
+                                              const TacsScalar v[],
+                                              const TacsScalar dv[],
+                                              const TacsScalar ddv[],
+                                              const int *dmapf,
+                                              TacsScalar res[],
+                                              TacsScalar mat[] ){
+  const int ndvpn   = delem->getVarsPerNode();
+  const int nsvpn   = this->getVarsPerNode();
+  const int nddof   = delem->getNumVariables();
+  const int nsdof   = this->getNumVariables();
+  const int nsterms = pc->getNumBasisTerms();
+  const int nnodes  = this->getNumNodes();
+  const int nsparams = pc->getNumParameters();
+  const int stride  = nsparams + 1 + nsterms;
+
+  // Group the nonzero blocks by the rule that is exact for them
+  int *blocknz = new int[nsterms*nsterms];
+  getBlockSparsity(blocknz);
+
+  std::map<std::vector<int>, std::vector<int> > groups;
+  std::vector<int> nqpts(nsparams);
+  std::vector<int> dmapi(nsparams), dmapj(nsparams);
+  for (int i = 0; i < nsterms; i++){
+    pc->getBasisParamDeg(i, dmapi.data());
+    for (int j = 0; j < nsterms; j++){
+      if (blocknz[i*nsterms + j]){
+        pc->getBasisParamDeg(j, dmapj.data());
+        for (int p = 0; p < nsparams; p++){
+          nqpts[p] = (dmapi[p] + dmapj[p] + dmapf[p])/2 + 1;
+        }
+        groups[nqpts].push_back(i*nsterms + j);
+      }
+    }
+  }
+  delete [] blocknz;
+
+  // The residual is integrated on the single rule exact for all
+  // blocks, which joins the groups (without blocks if none needs it)
+  std::map<std::vector<int>, std::vector<int> >::iterator it;
+  std::vector<int> envelope(nsparams, 1);
+  for (it = groups.begin(); it != groups.end(); it++){
+    for (int p = 0; p < nsparams; p++){
+      if (it->first[p] > envelope[p]){
+        envelope[p] = it->first[p];
+      }
+    }
+  }
+  groups[envelope];
+
+  // Use the envelope for all blocks instead when it is cheaper,
+  // costing an evaluation of the element as one block update
+  double grouped_cost = 0.0, envelope_size = 0.0;
+  int nblocks = 0;
+  for (it = groups.begin(); it != groups.end(); it++){
+    double size = 1.0;
+    for (int p = 0; p < nsparams; p++){
+      AbstractParameter *param = pc->getParameter(p);
+      size *= param->getQuadratureSize(param->getQuadratureLevel(it->first[p]));
+    }
+    if (it->first == envelope){
+      envelope_size = size;
+    }
+    grouped_cost += size*(1 + it->second.size());
+    nblocks += it->second.size();
+  }
+  if (envelope_size*(1 + nblocks) <= grouped_cost){
+    std::vector<int> all;
+    for (it = groups.begin(); it != groups.end(); it++){
+      all.insert(all.end(), it->second.begin(), it->second.end());
+    }
+    groups.clear();
+    groups[envelope] = all;
+  }
+
+  // Points of all the rules one after another
+  const int ngroups = groups.size();
+  std::vector<const TacsScalar*> rules(ngroups);
+  std::vector<const std::vector<int>*> blocks(ngroups);
+  std::vector<int> offset(ngroups + 1, 0);
+  int g = 0, genv = 0;
+  for (it = groups.begin(); it != groups.end(); it++, g++){
+    if (it->first == envelope){
+      genv = g;
+    }
+    const std::vector<TacsScalar> &rule = getBlockRule(it->first);
+    rules[g] = rule.data();
+    blocks[g] = &it->second;
+    offset[g+1] = offset[g] + rule.size()/stride;
+  }
+
+  // Scratch arrays are taken from the workspace of this thread
+  TACSStochasticWorkspace::Frame work(work_size);
+
+  // Stochastic states in termwise order (nsterms x 3*nddof)
+  TacsScalar *vtmp = work.allocate(nsterms*3*nddof);
+  gatherTermwise(nnodes, nsterms, ndvpn, v, vtmp, 3*nddof);
+  gatherTermwise(nnodes, nsterms, ndvpn, dv, &vtmp[nddof], 3*nddof);
+  gatherTermwise(nnodes, nsterms, ndvpn, ddv, &vtmp[2*nddof], 3*nddof);
+
+  TacsScalar *outs[2] = {res, mat};
+  const size_t sizes[2] = {size_t(nsdof), size_t(nsdof)*nsdof};
+  integrate(offset[ngroups], 2, sizes, outs,
+            [&]( TACSElement *elem, int tstart, int tend, TacsScalar **rm ){
+    TACSStochasticWorkspace::Frame qwork;
+    TacsScalar *uq   = qwork.allocate(3*nddof);
+    TacsScalar *resq = qwork.allocate(nddof);
+    TacsScalar *A    = qwork.allocate(nddof*nddof);
+
+    // Projected residual of every basis term (nsterms x nddof)
+    TacsScalar *rtmp = qwork.allocate(nsterms*nddof);
+    memset(rtmp, 0, nsterms*nddof*sizeof(TacsScalar));
+
+    int grp = 0;
+    for (int t = tstart; t < tend; t++){
+      while (t >= offset[grp+1]){
+        grp++;
+      }
+      const TacsScalar *entry = &rules[grp][size_t(t - offset[grp])*stride];
+      const TacsScalar wq = entry[nsparams];
+      const TacsScalar *psiq = &entry[nsparams + 1];
+
+      // Set the parameter values into the element
+      TacsScalar *yq = const_cast<TacsScalar*>(entry);
+      updateElement(elem, yq);
+
+      // States at the point of the rule
+      MatrixKernels::gemm(0, 0, 1, 3*nddof, nsterms, 1.0,
+                          psiq, nsterms, vtmp, 3*nddof, 0.0, uq, 3*nddof);
+
+      memset(resq, 0, nddof*sizeof(TacsScalar));
+      memset(A, 0, nddof*nddof*sizeof(TacsScalar));
+      elem->addJacobian(elemIndex, time, alpha, beta, gamma,
+                        X, uq, &uq[nddof], &uq[2*nddof], resq, A);
+
+      // Project the residual on the points of the envelope
+      if (grp == genv){
+        for (int k = 0; k < nsterms; k++){
+          const TacsScalar scale = psiq[k]*wq;
+          for (int d = 0; d < nddof; d++){
+            rtmp[k*nddof + d] += scale*resq[d];
+          }
+        }
+      }
+
+      // Scatter into the blocks integrated by this rule
+      const std::vector<int> &blk = *blocks[grp];
+      for (size_t b = 0; b < blk.size(); b++){
+        const int i = blk[b]/nsterms;
+        const int j = blk[b]%nsterms;
+        TacsScalar scale = psiq[i]*psiq[j]*wq;
+        for (int ni = 0; ni < nnodes; ni++){
+          int liptr = ni*ndvpn;
+          int giptr = ni*nsvpn + i*ndvpn;
+          for (int di = 0; di < ndvpn; di++){
+            for (int nj = 0; nj < nnodes; nj++){
+              int ljptr = nj*ndvpn;
+              int gjptr = nj*nsvpn + j*ndvpn;
+              for (int dj = 0; dj < ndvpn; dj++){
+                addElement(rm[1], nsdof,
+                           giptr + di, gjptr + dj,
+                           scale*getElement(A, nddof,
+                                            liptr + di, ljptr + dj));
+              }
+            }
+          }
+        }
+      }
+    }
+
+    // Store the projected residuals into stochastic array
+    scatterTermwise(nnodes, nsterms, ndvpn, rtmp, nddof, rm[0]);
+  });
+}
+
+/*
+  Integrate over npts points with slice(elem, qstart, qend, outs),
+  which adds the contributions of the points in [qstart, qend) into
+  outs using the deterministic element elem.
+
+  With several threads, each thread accumulates its range of points
+  into private copies of the outputs. After all threads finish, each
+  thread sums a disjoint range of entries across the copies into the
+  outputs, so the reduction needs no locks.
+
+  @param npts the number of points (e.g. quadrature points)
+  @param nouts the number of outputs
+  @param sizes the size of each output
+  @param outs the outputs, added into
+  @param slice the contribution of a range of quadrature points
+*/
+template <class Slice>
+void TACSStochasticElement::integrate( int nqpts, int nouts,
+                                       const size_t *sizes,
+                                       TacsScalar **outs, Slice slice ){
+  if (nthreads <= 1){
+    slice(delem, 0, nqpts, outs);
+    return;
+  }
+
+  // The basis table is built on first access, before the threads
+  // read it
+  pc->getBasisColumn(0);
+
+  std::vector<TacsScalar*> partial(nthreads*nouts);
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads)
+#endif
+  {
+    int tid = 0, nt = 1;
+#ifdef _OPENMP
+    tid = omp_get_thread_num();
+    nt = omp_get_num_threads();
+#endif
+    TACSStochasticWorkspace::Frame work;
+    TacsScalar **outq = &partial[tid*nouts];
+    for (int k = 0; k < nouts; k++){
+      outq[k] = work.allocate(sizes[k]);
+      memset(outq[k], 0, sizes[k]*sizeof(TacsScalar));
+    }
+
+    // Contribution of this thread's range of quadrature points
+    slice(thread_elems[tid], (nqpts*tid)/nt, (nqpts*(tid+1))/nt, outq);
+
+#ifdef _OPENMP
+#pragma omp barrier
+#endif
+
+    // Reduce this thread's range of entries across the threads
+    for (int k = 0; k < nouts; k++){
+      const size_t start = (sizes[k]*tid)/nt;
+      const size_t end = (sizes[k]*(tid+1))/nt;
+      for (int t = 0; t < nt; t++){
+        const TacsScalar *p = partial[t*nouts + k];
+        for (size_t e = start; e < end; e++){
+          outs[k][e] += p[e];
+        }
+      }
+    }
+
+    // Keep the partial outputs alive until all threads are done
+#ifdef _OPENMP
+#pragma omp barrier
+#endif
+  }
+}
+
 /*
   TACS Element member functions
 */
@@ -169,83 +790,65 @@ void TACSStochasticElement::getInitConditions( int elemIndex,
                                                TacsScalar dv[],
                                                TacsScalar ddv[] ){
   const int ndvpn   = delem->getVarsPerNode();
-  const int nsvpn   = this->getVarsPerNode();
   const int nddof   = delem->getNumVariables();
-  const int nsdof   = this->getNumVariables();
   const int nsterms = pc->getNumBasisTerms();
   const int nnodes  = this->getNumNodes();
-
-  // Space for quadrature points and weights
   const int nsparams = pc->getNumParameters();
-  TacsScalar *zq = new TacsScalar[nsparams];
-  TacsScalar *yq = new TacsScalar[nsparams];
-  TacsScalar wq;
-
-  // Create space for states
-  TacsScalar *uq    = new TacsScalar[nddof];
-  TacsScalar *udq   = new TacsScalar[nddof];
-  TacsScalar *uddq  = new TacsScalar[nddof];
+  const int nchunk  = pc->getQuadratureChunkSize();
 
-  TacsScalar *utmpk    = new TacsScalar[nddof];
-  TacsScalar *udtmpk   = new TacsScalar[nddof];
-  TacsScalar *uddtmpk  = new TacsScalar[nddof];
+  // Scratch arrays are taken from the workspace of this thread
+  TACSStochasticWorkspace::Frame work(work_size);
 
-  const int nqpts = pc->getNumQuadraturePoints();
+  // Projected initial conditions of every basis term, with the
+  // states, rates and accelerations side by side (nsterms x 3*nddof)
+  TacsScalar *utmp = work.allocate(nsterms*3*nddof);
+  memset(utmp, 0, nsterms*3*nddof*sizeof(TacsScalar));
 
   //  Projection of initial conditions and return
-  for (int k = 0; k < nsterms; k++){
+  const size_t size = nsterms*3*nddof;
+  integrate(pc->getNumQuadraturePoints(), 1, &size, &utmp,
+            [&]( TACSElement *elem, int qstart, int qend, TacsScalar **u ){
+    TACSStochasticWorkspace::Frame qwork;
 
-    memset(utmpk  , 0, nddof*sizeof(TacsScalar));
-    memset(udtmpk , 0, nddof*sizeof(TacsScalar));
-    memset(uddtmpk, 0, nddof*sizeof(TacsScalar));
+    // Space for quadrature points and weights
+    TacsScalar *zq = qwork.allocate(nsparams);
+    TacsScalar *yq = qwork.allocate(nsparams);
 
-    for (int q = 0; q < nqpts; q++){
-      // Get the quadrature points and weights
-      wq = pc->quadrature(q, zq, yq);
+    // Deterministic initial conditions at a chunk of quadrature points
+    TacsScalar *uc = qwork.allocate(nchunk*3*nddof);
 
-      // Set the parameter values into the element
-      updateElement(delem, yq);
-
-      // reset the states to zero
-      memset(uq  , 0, nddof*sizeof(TacsScalar));
-      memset(udq , 0, nddof*sizeof(TacsScalar));
-      memset(uddq, 0, nddof*sizeof(TacsScalar));
-
-      // Fetch the deterministic element residual
-      delem->getInitConditions(elemIndex, X, uq, udq, uddq);
-
-      // Project the determinic states onto the stochastic basis and
-      // place in global state array
-      TacsScalar scale = pc->basis(k,zq)*wq;
-      for (int c = 0; c < nddof; c++){
-        utmpk[c] += uq[c]*scale;
-        udtmpk[c] += udq[c]*scale;
-        uddtmpk[c] += uddq[c]*scale;
-      }
+    for (int q0 = qstart; q0 < qend; q0 += nchunk){
+      const int npts = (q0 + nchunk < qend) ? nchunk : qend - q0;
+      memset(uc, 0, npts*3*nddof*sizeof(TacsScalar));
 
-    } // quadrature
+      for (int p = 0; p < npts; p++){
+        const int q = q0 + p;
+
+        // Get the quadrature points
+        pc->quadrature(q, zq, yq);
+
+        // Set the parameter values into the element
+        TACSElement *qelem = getParameterizedElement(q, elem, yq);
 
-    // Store the initial conditions in termwise order
-    for (int n = 0; n < nnodes; n++){
-      int lptr = n*ndvpn;
-      int gptr = n*nsvpn + k*ndvpn;
-      for (int d = 0; d < ndvpn; d++){        
-        v[gptr+d] = utmpk[lptr+d];
-        dv[gptr+d] = udtmpk[lptr+d];
-        ddv[gptr+d] = uddtmpk[lptr+d];
+        // Fetch the deterministic initial conditions
+        TacsScalar *uq = &uc[3*p*nddof];
+        qelem->getInitConditions(elemIndex, X, uq, &uq[nddof], &uq[2*nddof]);
       }
-    }
-  }
 
-  // clear the heap
-  delete [] uq;
-  delete [] udq;
-  delete [] uddq;
-  delete [] utmpk;
-  delete [] udtmpk;
-  delete [] uddtmpk;
-  delete [] zq;
-  delete [] yq;
+      // Project the deterministic states of the chunk onto every
+      // stochastic basis term
+      project(pc, q0, npts, 3*nddof, uc, u[0]);
+
+    } // quadrature
+  });
+
+  // Store the initial conditions in termwise order
+  memset(v  , 0, this->getNumVariables()*sizeof(TacsScalar));
+  memset(dv , 0, this->getNumVariables()*sizeof(TacsScalar));
+  memset(ddv, 0, this->getNumVariables()*sizeof(TacsScalar));
+  scatterTermwise(nnodes, nsterms, ndvpn, utmp, 3*nddof, v);
+  scatterTermwise(nnodes, nsterms, ndvpn, &utmp[nddof], 3*nddof, dv);
+  scatterTermwise(nnodes, nsterms, ndvpn, &utmp[2*nddof], 3*nddof, ddv);
 }
 
 /*
@@ -259,78 +862,71 @@ void TACSStochasticElement::addResidual( int elemIndex,
                                          const TacsScalar ddv[],
                                          TacsScalar res[] ){
   const int ndvpn   = delem->getVarsPerNode();
-  const int nsvpn   = this->getVarsPerNode();
   const int nddof   = delem->getNumVariables();
-  const int nsdof   = this->getNumVariables();
   const int nsterms = pc->getNumBasisTerms();
   const int nnodes  = this->getNumNodes();
-
-  // Space for quadrature points and weights
   const int nsparams = pc->getNumParameters();
-  TacsScalar *zq = new TacsScalar[nsparams];
-  TacsScalar *yq = new TacsScalar[nsparams];
-  TacsScalar wq;
+  const int nchunk  = pc->getQuadratureChunkSize();
 
-  // Create space for fetching deterministic residuals and states
-  TacsScalar *uq    = new TacsScalar[nddof];
-  TacsScalar *udq   = new TacsScalar[nddof];
-  TacsScalar *uddq  = new TacsScalar[nddof];
-  TacsScalar *resq  = new TacsScalar[nddof];
-  TacsScalar *rtmpi = new TacsScalar[nddof];
+  // Scratch arrays are taken from the workspace of this thread
+  TACSStochasticWorkspace::Frame work(work_size);
 
-  const int nqpts = pc->getNumQuadraturePoints();
+  // Stochastic states in termwise order (nsterms x 3*nddof)
+  TacsScalar *vtmp = work.allocate(nsterms*3*nddof);
+  gatherTermwise(nnodes, nsterms, ndvpn, v, vtmp, 3*nddof);
+  gatherTermwise(nnodes, nsterms, ndvpn, dv, &vtmp[nddof], 3*nddof);
+  gatherTermwise(nnodes, nsterms, ndvpn, ddv, &vtmp[2*nddof], 3*nddof);
 
-  for (int i = 0; i < nsterms; i++){
+  // Projected residual of every basis term (nsterms x nddof)
+  TacsScalar *rtmp  = work.allocate(nsterms*nddof);
+  memset(rtmp, 0, nsterms*nddof*sizeof(TacsScalar));
 
-    memset(rtmpi, 0, nddof*sizeof(TacsScalar));
+  const size_t size = nsterms*nddof;
+  integrate(pc->getNumQuadraturePoints(), 1, &size, &rtmp,
+            [&]( TACSElement *elem, int qstart, int qend, TacsScalar **r ){
+    TACSStochasticWorkspace::Frame qwork;
 
-    for (int q = 0; q < nqpts; q++){
+    // Space for quadrature points and weights
+    TacsScalar *zq = qwork.allocate(nsparams);
+    TacsScalar *yq = qwork.allocate(nsparams);
 
-      // Get the quadrature points and weights
-      wq = pc->quadrature(q, zq, yq);
+    // Deterministic states and residuals at a chunk of quadrature
+    // points
+    TacsScalar *uc = qwork.allocate(nchunk*3*nddof);
+    TacsScalar *rc = qwork.allocate(nchunk*nddof);
 
-      // Set the parameter values into the element
-      updateElement(delem, yq);
+    for (int q0 = qstart; q0 < qend; q0 += nchunk){
+      const int npts = (q0 + nchunk < qend) ? nchunk : qend - q0;
 
-      // reset the states and residuals
-      memset(resq, 0, nddof*sizeof(TacsScalar));
+      // Form the state vectors at every point of the chunk
+      reconstruct(pc, q0, npts, 3*nddof, vtmp, uc);
+      memset(rc, 0, npts*nddof*sizeof(TacsScalar));
 
-      // Evaluate the basis at quadrature node and form the state
-      // vectors
-      getDeterministicStates(pc, delem, this, v, dv, ddv, zq, 
-                             uq, udq, uddq);
+      for (int p = 0; p < npts; p++){
+        const int q = q0 + p;
 
-      // Fetch the deterministic element residual
-      delem->addResidual(elemIndex, time, X, uq, udq, uddq, resq);
-
-      //  Project the determinic element residual onto the
-      //  stochastic basis and place in global residual array
-      TacsScalar scale = pc->basis(i,zq)*wq;
-      for (int c = 0; c < nddof; c++){
-        rtmpi[c] += resq[c]*scale;
-      }
+        // Get the quadrature points
+        pc->quadrature(q, zq, yq);
 
-    } // quadrature
+        // Set the parameter values into the element
+        TACSElement *qelem = getParameterizedElement(q, elem, yq);
 
-    // Store i-th projected Residual into stochastic array
-    for (int n = 0; n < nnodes; n++){
-      int lptr = n*ndvpn;
-      int gptr = n*nsvpn + i*ndvpn;
-      for (int d = 0; d < ndvpn; d++){        
-        res[gptr+d] += rtmpi[lptr+d];
+        // Fetch the deterministic element residual
+        const TacsScalar *uq = &uc[3*p*nddof];
+        qelem->addResidual(elemIndex, time, X,
+                           uq, &uq[nddof], &uq[2*nddof],
+                           &rc[p*nddof]);
       }
-    }
 
-  } // end nsterms
+      //  Project the determinic element residuals of the chunk onto
+      //  every stochastic basis term
+      project(pc, q0, npts, nddof, rc, r[0]);
 
-  // clear the heap
-  delete [] rtmpi;
-  delete [] resq;
-  delete [] uq;
-  delete [] udq;
-  delete [] uddq;
-  delete [] zq;
-  delete [] yq;
+    } // quadrature
+  });
+
+  // Store the projected residuals into stochastic array
+  scatterTermwise(nnodes, nsterms, ndvpn, rtmp, nddof, res);
 }
 
 void TACSStochasticElement::addJacobian( int elemIndex,
@@ -344,109 +940,136 @@ void TACSStochasticElement::addJacobian( int elemIndex,
                                          const TacsScalar ddv[],
                                          TacsScalar res[],
                                          TacsScalar mat[] ){
-  // Call the residual implementation
-  addResidual(elemIndex, time, X, v, dv, ddv, res);
-
   const int ndvpn   = delem->getVarsPerNode();
   const int nsvpn   = this->getVarsPerNode();
   const int nddof   = delem->getNumVariables();
   const int nsdof   = this->getNumVariables();
   const int nsterms = pc->getNumBasisTerms();
   const int nnodes  = this->getNumNodes();
-
-  // Space for quadrature points and weights
   const int nsparams = pc->getNumParameters();
-  TacsScalar *zq = new TacsScalar[nsparams];
-  TacsScalar *yq = new TacsScalar[nsparams];
-  TacsScalar wq;
+  const int nchunk  = pc->getQuadratureChunkSize();
+
+  // Integrate each block on its own rule when the degrees are known
+  std::vector<int> dmapf(nsparams);
+  if (block_quadrature && !getJacobianDegrees(dmapf.data())){
+    addBlockJacobian(elemIndex, time, alpha, beta, gamma,
+                     X, v, dv, ddv, dmapf.data(), res, mat);
+    return;
+  }
 
-  // polynomial degrees
-  int dmapi[nsparams], dmapj[nsparams], dmapf[nsparams];
+  // Scratch arrays are taken from the workspace of this thread
+  TACSStochasticWorkspace::Frame work(work_size);
 
-  // Assume all parameters to be of degree atmost 3 (faster)
-  for (int i = 0; i <nsparams; i++){
-    dmapf[i] = 3;
-  }
+  // Stochastic states in termwise order (nsterms x 3*nddof)
+  TacsScalar *vtmp = work.allocate(nsterms*3*nddof);
+  gatherTermwise(nnodes, nsterms, ndvpn, v, vtmp, 3*nddof);
+  gatherTermwise(nnodes, nsterms, ndvpn, dv, &vtmp[nddof], 3*nddof);
+  gatherTermwise(nnodes, nsterms, ndvpn, ddv, &vtmp[2*nddof], 3*nddof);
 
-  // Create space for fetching deterministic residuals and states
-  TacsScalar *uq    = new TacsScalar[nddof];
-  TacsScalar *udq   = new TacsScalar[nddof];
-  TacsScalar *uddq  = new TacsScalar[nddof];
-  TacsScalar *A     = new TacsScalar[nddof*nddof];
-  TacsScalar *resq  = new TacsScalar[nddof];
+  // Galerkin blocks that are structurally nonzero
+  int *blocknz = new int[nsterms*nsterms];
+  getBlockSparsity(blocknz);
 
-  const int nqpts = pc->getNumQuadraturePoints();
+  TacsScalar *outs[2] = {res, mat};
+  const size_t sizes[2] = {size_t(nsdof), size_t(nsdof)*nsdof};
 
-  for (int i = 0; i < nsterms; i++){
+  integrate(pc->getNumQuadraturePoints(), 2, sizes, outs,
+            [&]( TACSElement *elem, int qstart, int qend, TacsScalar **rm ){
+    TacsScalar *sres = rm[0];
+    TacsScalar *smat = rm[1];
 
-    pc->getBasisParamDeg(i, dmapi);
+    // Scratch arrays are taken from the workspace of this thread
+    TACSStochasticWorkspace::Frame qwork;
 
-    for (int j = 0; j < nsterms; j++){
+    // Space for quadrature points and weights
+    TacsScalar *zq = qwork.allocate(nsparams);
+    TacsScalar *yq = qwork.allocate(nsparams);
+    TacsScalar wq;
 
-      pc->getBasisParamDeg(j, dmapj);
+    // Deterministic states and residuals at a chunk of quadrature
+    // points, the jacobian of one point and the projected residual
+    TacsScalar *uc    = qwork.allocate(nchunk*3*nddof);
+    TacsScalar *rc    = qwork.allocate(nchunk*nddof);
+    TacsScalar *A     = qwork.allocate(nddof*nddof);
+    TacsScalar *rtmp  = qwork.allocate(nsterms*nddof);
+    memset(rtmp, 0, nsterms*nddof*sizeof(TacsScalar));
 
-      if (1){ // nonzero(nsparams, dmapi, dmapj, dmapf)){
+    for (int q0 = qstart; q0 < qend; q0 += nchunk){
+      const int npts = (q0 + nchunk < qend) ? nchunk : qend - q0;
 
-        memset(A, 0, nddof*nddof*sizeof(TacsScalar));
+      // Form the state vectors at every point of the chunk
+      reconstruct(pc, q0, npts, 3*nddof, vtmp, uc);
+      memset(rc, 0, npts*nddof*sizeof(TacsScalar));
 
-        for (int q = 0; q < nqpts; q++){
+      for (int p = 0; p < npts; p++){
+        const int q = q0 + p;
 
-          // Get quadrature points
-          wq = pc->quadrature(q, zq, yq);
+        // Get quadrature points
+        wq = pc->quadrature(q, zq, yq);
 
-          // Set the parameter values into the element
-          this->updateElement(this->delem, yq);
+        // Set the parameter values into the element
+        TACSElement *qelem = getParameterizedElement(q, elem, yq);
 
-          // Evaluate the basis at quadrature node and form the state
-          // vectors
-          getDeterministicStates(pc, delem, this, v, dv, ddv, zq, 
-                                 uq, udq, uddq);
+        // Fetch the deterministic element residual and jacobian once
+        // per quadrature node, as they do not depend on the basis
+        // terms
+        const TacsScalar *psiq = pc->getBasisColumn(q);
+        const TacsScalar *uq = &uc[3*p*nddof];
+        memset(A, 0, nddof*nddof*sizeof(TacsScalar));
+        qelem->addJacobian(elemIndex,
+                           time,
+                           alpha, beta, gamma,
+                           X, uq, &uq[nddof], &uq[2*nddof],
+                           &rc[p*nddof],
+                           A);
+
+        // Scatter the weighted jacobian into each (i,j) stochastic
+        // block
+        for (int i = 0; i < nsterms; i++){
+
+          for (int j = 0; j < nsterms; j++){
+
+            if (blocknz[i*nsterms + j]){
+
+              TacsScalar scale = psiq[i]*psiq[j]*wq;
+
+              // Place the (i,j)-projected block into the stochastic block
+              for (int ni = 0; ni < nnodes; ni++){
+                int liptr = ni*ndvpn;
+                int giptr = ni*nsvpn + i*ndvpn;
+                for (int di = 0; di < ndvpn; di++){
+                  for (int nj = 0; nj < nnodes; nj++){
+                    int ljptr = nj*ndvpn;
+                    int gjptr = nj*nsvpn + j*ndvpn;
+                    for (int dj = 0; dj < ndvpn; dj++){
+                      addElement(smat, nsdof,
+                                 giptr + di, gjptr + dj,
+                                 scale*getElement(A, nddof,
+                                                  liptr + di, ljptr + dj));
+                    }
+                  }
+                }
+              }
 
+            } // nonzero
 
-          // Fetch the deterministic element residual
-          TacsScalar scale = pc->basis(i,zq)*pc->basis(j,zq)*wq;
-          this->delem->addJacobian(elemIndex,
-                                   time,
-                                   scale*alpha, scale*beta, scale*gamma,
-                                   X, uq, udq, uddq,
-                                   resq,
-                                   A);
-        } // quadrature
+          } // end j
 
-        // Place the (i,j)-projected block into the stochastic block
-        for (int ni = 0; ni < nnodes; ni++){
-          int liptr = ni*ndvpn;
-          int giptr = ni*nsvpn + i*ndvpn;
-          for (int di = 0; di < ndvpn; di++){
-            for (int nj = 0; nj < nnodes; nj++){
-              int ljptr = nj*ndvpn;
-              int gjptr = nj*nsvpn + j*ndvpn;
-              for (int dj = 0; dj < ndvpn; dj++){
-                addElement(mat, nsdof, 
-                           giptr + di, gjptr + dj,
-                           getElement(A, nddof, 
-                                      liptr + di, ljptr + dj));
-              }
-            }
-          }
-        }
+        } // end i
+      }
 
-      } // nonzero
+      // Project the deterministic residuals of the chunk onto every
+      // stochastic basis term
+      project(pc, q0, npts, nddof, rc, rtmp);
 
-    } // end j
+    } // quadrature
 
-  } // end i
+    scatterTermwise(nnodes, nsterms, ndvpn, rtmp, nddof, sres);
+  });
 
-  //  printSparsity(mat, nddof*nsterms);
+  delete [] blocknz;
 
-  // clear the heap
-  delete [] A;
-  delete [] resq;
-  delete [] uq;
-  delete [] udq;
-  delete [] uddq;
-  delete [] zq;
-  delete [] yq;
+  //  printSparsity(mat, nddof*nsterms);
 }
 
 int TACSStochasticElement::evalPointQuantity( int elemIndex, int quantityType, double time,
@@ -454,90 +1077,85 @@ int TACSStochasticElement::evalPointQuantity( int elemIndex, int quantityType, d
                                               const TacsScalar v[], const TacsScalar dv[],
                                               const TacsScalar ddv[], TacsScalar *quantity ) {
   const int ndvpn   = delem->getVarsPerNode();
-  const int nsvpn   = this->getVarsPerNode();
   const int nddof   = delem->getNumVariables();
   const int nnodes  = this->getNumNodes();
   const int nsterms = pc->getNumBasisTerms();
-
-  // Space for quadrature points and weights
   const int nsparams = pc->getNumParameters();
-  TacsScalar *zq = new TacsScalar[nsparams];
-  TacsScalar *yq = new TacsScalar[nsparams];
-  TacsScalar wq;
-  
-  // Create space for deterministic states at each quadrature node in y
-  TacsScalar *uq     = new TacsScalar[nddof];
-  TacsScalar *udq    = new TacsScalar[nddof];
-  TacsScalar *uddq   = new TacsScalar[nddof];
-  
+  const int nchunk  = pc->getQuadratureChunkSize();
+
+  // Scratch arrays are taken from the workspace of this thread
+  TACSStochasticWorkspace::Frame work(work_size);
+  TacsScalar *dummy = work.allocate(nddof);
+
   // Space to project each function in stochastic space and store
   // const  int ndquants = this->delem->getNumPointQuantities();
   const int ndquants = this->delem->evalPointQuantity(elemIndex,
                                                       quantityType,
-                                                      time, N, pt, Xpts, 
-                                                      v, dv, ddv, 
-                                                      uq); // dummy 
+                                                      time, N, pt, Xpts,
+                                                      v, dv, ddv,
+                                                      dummy); // dummy
   const int nsquants = nsterms*ndquants;
 
-  TacsScalar *ftmpq  = new TacsScalar[ndquants];
-  TacsScalar *ftmpi  = new TacsScalar[ndquants];  
+  // Stochastic states in termwise order (nsterms x 3*nddof)
+  TacsScalar *vtmp = work.allocate(nsterms*3*nddof);
+  gatherTermwise(nnodes, nsterms, ndvpn, v, vtmp, 3*nddof);
+  gatherTermwise(nnodes, nsterms, ndvpn, dv, &vtmp[nddof], 3*nddof);
+  gatherTermwise(nnodes, nsterms, ndvpn, ddv, &vtmp[2*nddof], 3*nddof);
 
-  const int nqpts = pc->getNumQuadraturePoints();
-  
-  for (int i = 0; i < nsterms; i++){
+  // Projected quantities stored as quantity[d*nsterms+i]
+  memset(quantity, 0, nsquants*sizeof(TacsScalar));
 
-    memset(ftmpi, 0, ndquants*sizeof(TacsScalar));
+  const size_t size = nsquants;
+  integrate(pc->getNumQuadraturePoints(), 1, &size, &quantity,
+            [&]( TACSElement *elem, int qstart, int qend, TacsScalar **f ){
+    TACSStochasticWorkspace::Frame qwork;
 
-    for (int q = 0; q < nqpts; q++){
+    // Space for quadrature points and weights
+    TacsScalar *zq = qwork.allocate(nsparams);
+    TacsScalar *yq = qwork.allocate(nsparams);
 
-      // Get the quadrature points and weights
-      wq = pc->quadrature(q, zq, yq);
+    // Deterministic states and quantities at a chunk of quadrature
+    // points
+    TacsScalar *uc = qwork.allocate(nchunk*3*nddof);
+    TacsScalar *fc = qwork.allocate(nchunk*ndquants);
 
-      // Set the parameter values into the element
-      this->updateElement(delem, yq);
-
-      // reset the states and residuals
-      memset(ftmpq, 0, ndquants*sizeof(TacsScalar));
-
-      // Evaluate the basis at quadrature node and form the state
-      // vectors
-      getDeterministicStates(pc, delem, this, v, dv, ddv, zq, 
-                             uq, udq, uddq);
-
-      // Fetch the deterministic element residual
-      int count = this->delem->evalPointQuantity(elemIndex,
-                                                 quantityType,
-                                                 time, N, pt,
-                                                 Xpts, uq, udq, uddq,
-                                                 ftmpq);
-      
-      // Project the determinic quantities onto the stochastic basis
-      // and place in stochastic function array
-      TacsScalar scale = pc->basis(i,zq)*wq;
-      for (int c = 0; c < ndquants; c++){
-        ftmpi[c] += ftmpq[c]*scale;
-      }
+    int ldq, ldk;
+    pc->getBasisTableStrides(&ldq, &ldk);
 
-    } // quadrature
+    for (int q0 = qstart; q0 < qend; q0 += nchunk){
+      const int npts = (q0 + nchunk < qend) ? nchunk : qend - q0;
 
-    // Store i-th projected Residual into stochastic array
-    for (int d = 0; d < ndquants; d++){        
-      quantity[d*nsterms+i] = ftmpi[d];
-      // printf("nsterms = %d ndquants = %d, i = %d local [%d]  global[%d] \n", nsterms, ndquants,
-      // i, d, d*nsterms + i);
-    }
+      // Form the state vectors at every point of the chunk
+      reconstruct(pc, q0, npts, 3*nddof, vtmp, uc);
+      memset(fc, 0, npts*ndquants*sizeof(TacsScalar));
 
-  } // nterms
+      for (int p = 0; p < npts; p++){
+        const int q = q0 + p;
 
-  delete [] zq;
-  delete [] yq;
+        // Get the quadrature points
+        pc->quadrature(q, zq, yq);
+
+        // Set the parameter values into the element
+        TACSElement *qelem = getParameterizedElement(q, elem, yq);
+
+        // Fetch the deterministic element quantities
+        const TacsScalar *uq = &uc[3*p*nddof];
+        qelem->evalPointQuantity(elemIndex,
+                                 quantityType,
+                                 time, N, pt,
+                                 Xpts, uq, &uq[nddof], &uq[2*nddof],
+                                 &fc[p*ndquants]);
+      }
 
-  delete [] uq;
-  delete [] udq;
-  delete [] uddq;
+      // Project the determinic quantities of the chunk onto every
+      // stochastic basis term, f (ndquants x nsterms) += fc^T * (W Psi)^T
+      MatrixKernels::gemm(1, 1, ndquants, nsterms, npts, 1.0,
+                          fc, ndquants,
+                          &pc->getWeightedBasisRow(0)[q0], ldq,
+                          1.0, f[0], nsterms);
 
-  delete [] ftmpq;
-  delete [] ftmpi;
+    } // quadrature
+  });
 
   return nsquants;
 }
@@ -558,50 +1176,69 @@ void TACSStochasticElement::addAdjResProduct( int elemIndex, double time,
   //  printf("TACSStochasticElement::addAdjResProduct \n");
 
   const int ndvpn   = delem->getVarsPerNode();
-  const int nsvpn   = this->getVarsPerNode();
   const int nddof   = delem->getNumVariables();
   const int nnodes  = this->getNumNodes();
   const int nsterms = pc->getNumBasisTerms();
-
-  // Space for quadrature points and weights
   const int nsparams = pc->getNumParameters();
-  TacsScalar *zq = new TacsScalar[nsparams];
-  TacsScalar *yq = new TacsScalar[nsparams];
-  TacsScalar wq;
-  
-  // Create space for deterministic states at each quadrature node in y
-  TacsScalar *uq     = new TacsScalar[nddof];
-  TacsScalar *udq    = new TacsScalar[nddof];
-  TacsScalar *uddq   = new TacsScalar[nddof];
-  TacsScalar *psiq   = new TacsScalar[nddof];
-  TacsScalar *dfdxj  = new TacsScalar[dvLen]; // check if this is one function at a time
-
-  const int nqpts = pc->getNumQuadraturePoints();
-  
+  const int nchunk  = pc->getQuadratureChunkSize();
+
+  // Scratch arrays are taken from the workspace of this thread
+  TACSStochasticWorkspace::Frame work(work_size);
+  TacsScalar *dfdxj  = work.allocate(dvLen); // check if this is one function at a time
+
+  // Stochastic states and adjoint in termwise order (nsterms x 4*nddof)
+  TacsScalar *vtmp = work.allocate(nsterms*4*nddof);
+  gatherTermwise(nnodes, nsterms, ndvpn, v, vtmp, 4*nddof);
+  gatherTermwise(nnodes, nsterms, ndvpn, dv, &vtmp[nddof], 4*nddof);
+  gatherTermwise(nnodes, nsterms, ndvpn, ddv, &vtmp[2*nddof], 4*nddof);
+  gatherTermwise(nnodes, nsterms, ndvpn, psi, &vtmp[3*nddof], 4*nddof);
+
   for (int j = 0; j < 1; j++){
 
     memset(dfdxj, 0, dvLen*sizeof(TacsScalar));
 
-    for (int q = 0; q < nqpts; q++){
+    const size_t size = dvLen;
+    integrate(pc->getNumQuadraturePoints(), 1, &size, &dfdxj,
+              [&]( TACSElement *elem, int qstart, int qend, TacsScalar **dfdxq ){
+      TACSStochasticWorkspace::Frame qwork;
 
-      // Get the quadrature points and weights
-      wq = pc->quadrature(q, zq, yq);
+      // Space for quadrature points and weights
+      TacsScalar *zq = qwork.allocate(nsparams);
+      TacsScalar *yq = qwork.allocate(nsparams);
+      TacsScalar wq;
 
-      TacsScalar wt = pc->basis(j,zq)*wq;
+      // Deterministic states and adjoint at a chunk of quadrature
+      // points
+      TacsScalar *uc = qwork.allocate(nchunk*4*nddof);
 
-      // Set the parameter values into the element
-      this->updateElement(delem, yq);
+      for (int q0 = qstart; q0 < qend; q0 += nchunk){
+        const int npts = (q0 + nchunk < qend) ? nchunk : qend - q0;
 
-      // Form deterministi states and adjoint vectors from global array
-      getDeterministicStates(pc, delem, this, v, dv, ddv, zq, uq, udq, uddq);
-      getDeterministicAdjoint(pc, delem, this, psi, zq, psiq);
+        // Form deterministic states and adjoint vectors at every point
+        // of the chunk
+        reconstruct(pc, q0, npts, 4*nddof, vtmp, uc);
 
-      delem->addAdjResProduct(elemIndex, time, wt*scale,
-                              psiq, Xpts, uq, udq, uddq,
-                              dvLen, dfdxj);
+        for (int p = 0; p < npts; p++){
+          const int q = q0 + p;
 
-    } // end quadrature
+          // Get the quadrature points and weights
+          wq = pc->quadrature(q, zq, yq);
+
+          const TacsScalar *psikq = pc->getBasisColumn(q);
+          TacsScalar wt = psikq[j]*wq;
 
+          // Set the parameter values into the element
+          TACSElement *qelem = getParameterizedElement(q, elem, yq);
+
+          const TacsScalar *uq = &uc[4*p*nddof];
+          qelem->addAdjResProduct(elemIndex, time, wt*scale,
+                                  &uq[3*nddof], Xpts,
+                                  uq, &uq[nddof], &uq[2*nddof],
+                                  dvLen, dfdxq[0]);
+        }
+
+      } // end quadrature
+    });
     // need to be careful with nodewise placement of dvs
     for (int n = 0; n < dvLen; n++){
       dfdx[n] += dfdxj[n];
@@ -625,13 +1262,4 @@ void TACSStochasticElement::addAdjResProduct( int elemIndex, double time,
   // fix
   // how is 'dfdx' bigger for stochastic element? are we multiplying
   // the nsterms with num det design variables?
-
-  // free up heap
-  delete [] zq;
-  delete [] yq;
-  delete [] uq;
-  delete [] udq;
-  delete [] uddq;
-  delete [] psiq;
-  delete [] dfdxj;
 }
@@ -1,8 +1,13 @@
 #ifndef TACS_STOCHASTIC_ELEMENT
 #define TACS_STOCHASTIC_ELEMENT
 
+#include <map>
+#include <vector>
+
 #include "TACSElement.h"
 #include "ParameterContainer.h"
+#include "TACSStochasticWorkspace.h"
+#include "TACSParameterizedElement.h"
 #include "Python.h"
 
 class TACSStochasticElement : public TACSElement {
@@ -68,10 +73,16 @@ class TACSStochasticElement : public TACSElement {
                          int dvLen, 
                          TacsScalar dfdx[] );
  
-  // Invoke this function to update this element through user supplied callback
+  // Invoke this function to update this element through its native
+  // parameter binding, when it maps any field, or the user supplied
+  // callback
   //---------------------------------------------------------------------------
   void updateElement(TACSElement* elem, TacsScalar* vals){
-    if (this->update && pyptr){
+    TACSParameterizedElement *pelem =
+      dynamic_cast<TACSParameterizedElement*>(elem);
+    if (pelem && pelem->getNumMappedFields() > 0){
+      pelem->setRandomParameters(vals);
+    } else if (this->update && pyptr){
       this->update(elem, vals, pyptr);
     } else {
       printf("skipping update of parameters \n");
@@ -81,6 +92,38 @@ class TACSStochasticElement : public TACSElement {
   TACSElement* getDeterministicElement(){
     return this->delem;
   };
+
+  // Keep a deterministic element parameterized at each quadrature point
+  //--------------------------------------------------------------------
+  void setQuadratureElements( int nqpts, TACSElement **qelems );
+  TACSElement* getParameterizedElement( int q, TACSElement *elem,
+                                        TacsScalar *yq );
+
+  // Deterministic vectors at a range of quadrature points or of
+  // each basis term
+  //-------------------------------------------------------------
+  void getDeterministicStates( int qstart, int npts, int nvecs,
+                               const TacsScalar *vecs[], TacsScalar *uq );
+  void getCoefficientStates( int nvecs, const TacsScalar *vecs[],
+                             TacsScalar *uk );
+
+  // Add the projection of deterministic vectors at a range of points
+  //-----------------------------------------------------------------
+  void addProjectedVectors( int qstart, int npts, const TacsScalar *fq,
+                            TacsScalar v[] );
+
+  // Structurally nonzero blocks of the stochastic jacobian
+  //-------------------------------------------------------
+  int getBlockSparsity( int *nz );
+
+  // Integrate each jacobian block with its smallest exact rule
+  //-----------------------------------------------------------
+  void setBlockQuadrature( int flag );
+
+  // Run the quadrature loops on threads with copies of the element
+  //---------------------------------------------------------------
+  void setNumThreads( int nthreads, TACSElement **clones );
+  int getNumThreads();
   
   /**
      Get the number of design variables per node.
@@ -157,6 +200,34 @@ class TACSStochasticElement : public TACSElement {
   // Stochastic element information
   int num_nodes;
   int vars_per_node;
+
+  // Size of the scratch workspace of the element kernels
+  size_t work_size;
+
+  // Deterministic element of each thread (the first is delem)
+  int nthreads;
+  TACSElement **thread_elems;
+
+  // Deterministic elements parameterized at each quadrature point
+  int num_qelems;
+  TACSElement **qelems;
+
+  // Blockwise quadrature of the jacobian and the cached rules
+  int block_quadrature;
+  std::map<std::vector<int>, std::vector<TacsScalar> > block_rules;
+  int getJacobianDegrees( int *dmapf );
+  const std::vector<TacsScalar>& getBlockRule( const std::vector<int> &nqpts );
+  void addBlockJacobian( int elemIndex, double time,
+                         TacsScalar alpha, TacsScalar beta, TacsScalar gamma,
+                         const TacsScalar X[], const TacsScalar v[],
+                         const TacsScalar dv[], const TacsScalar ddv[],
+                         const int *dmapf, TacsScalar res[],
+                         TacsScalar mat[] );
+
+  // Integrate a range of quadrature points over the threads
+  template <class Slice>
+  void integrate( int npts, int nouts, const size_t *sizes,
+                  TacsScalar **outs, Slice slice );
 };
 
 #endif
@@ -3,6 +3,7 @@
 
 #include "TACSFunction.h"
 #include "ParameterContainer.h"
+#include "TACSStochasticMoments.h"
 
 class TACSStochasticFFMeanFunction : public TACSFunction {
  public:
@@ -10,7 +11,8 @@ class TACSStochasticFFMeanFunction : public TACSFunction {
                                 TACSFunction *dfunc, 
                                 ParameterContainer *pc,
                                 int quantityType, 
-                                int moment_type = 0);
+                                int moment_type = 0,
+                                TACSStochasticMoments *moments = NULL );
   ~TACSStochasticFFMeanFunction();
   /**
      Get the object name
@@ -184,14 +186,21 @@ class TACSStochasticFFMeanFunction : public TACSFunction {
  
   TacsScalar getExpectation();
   TacsScalar getVariance();
+
+  /**
+     Return the moment engine to share it with other views
+  */
+  TACSStochasticMoments* getMoments(){
+    return this->moments;
+  }
   
  protected:  
   TACSFunction *dfunc;
   ParameterContainer *pc;
 
  private:
-  // Store function values
-  TacsScalar *fvals;
+  // Moments of the quantity, possibly shared with other views
+  TACSStochasticMoments *moments;
 
   // The name of the function
   static const char *funcName;
@@ -2,87 +2,17 @@
 #include "TACSStochasticFMeanFunction.h"
 #include "TACSStochasticElement.h"
 
-namespace {
-
-  void getDeterministicAdjoint( ParameterContainer *pc, 
-                                TACSElement *delem,
-                                TACSElement *selem, 
-                                const TacsScalar v[],
-                                TacsScalar *zq,
-                                TacsScalar *uq
-                                ){
-    int ndvpn   = delem->getVarsPerNode();
-    int nsvpn   = selem->getVarsPerNode();
-    int nddof   = delem->getNumVariables();
-    int nsdof   = selem->getNumVariables();
-    int nsterms = pc->getNumBasisTerms();
-    int nnodes  = selem->getNumNodes();
-    
-    memset(uq  , 0, nddof*sizeof(TacsScalar));
-
-    // Evaluate the basis at quadrature node and form the state
-    // vectors
-    for (int n = 0; n < nnodes; n++){
-      for (int k = 0; k < nsterms; k++){
-        TacsScalar psikz = pc->basis(k,zq);
-        int lptr = n*ndvpn;
-        int gptr = n*nsvpn + k*ndvpn;
-        for (int d = 0; d < ndvpn; d++){        
-          uq[lptr+d] += v[gptr+d]*psikz;
-        }
-      }
-    }
-  } 
-
-  void getDeterministicStates( ParameterContainer *pc, 
-                               TACSElement *delem,
-                               TACSElement *selem, 
-                               const TacsScalar v[],
-                               const TacsScalar dv[],
-                               const TacsScalar ddv[], 
-                               TacsScalar *zq,
-                               TacsScalar *uq,
-                               TacsScalar *udq,
-                               TacsScalar *uddq
-                               ){
-    int ndvpn   = delem->getVarsPerNode();
-    int nsvpn   = selem->getVarsPerNode();
-    int nddof   = delem->getNumVariables();
-    int nsdof   = selem->getNumVariables();
-    int nsterms = pc->getNumBasisTerms();
-    int nnodes  = selem->getNumNodes();
-
-    memset(uq  , 0, nddof*sizeof(TacsScalar));
-    memset(udq , 0, nddof*sizeof(TacsScalar));
-    memset(uddq, 0, nddof*sizeof(TacsScalar));
-
-    // Evaluate the basis at quadrature node and form the state
-    // vectors
-    for (int n = 0; n < nnodes; n++){
-      for (int k = 0; k < nsterms; k++){
-        TacsScalar psikz = pc->basis(k,zq);
-        int lptr = n*ndvpn;
-        int gptr = n*nsvpn + k*ndvpn;
-        for (int d = 0; d < ndvpn; d++){        
-          uq[lptr+d] += v[gptr+d]*psikz;
-          udq[lptr+d] += dv[gptr+d]*psikz;
-          uddq[lptr+d] += ddv[gptr+d]*psikz;
-        }
-      }
-    }
-  } 
-}
-
 TACSStochasticFMeanFunction::TACSStochasticFMeanFunction( TACSAssembler *tacs,
-                                                          TACSFunction *dfunc, 
+                                                          TACSFunction *dfunc,
                                                           ParameterContainer *pc,
                                                           int quantityType,
-                                                          int moment_type) 
+                                                          int moment_type,
+                                                          TACSStochasticMoments *moments )
   : TACSFunction(tacs,
                  dfunc->getDomainType(),
                  dfunc->getStageType(),
                  0)
-{  
+{
   this->tacs_comm = tacs->getMPIComm();
   this->dfunc = dfunc;
   this->dfunc->incref();
@@ -90,30 +20,34 @@ TACSStochasticFMeanFunction::TACSStochasticFMeanFunction( TACSAssembler *tacs,
   this->quantityType = quantityType;
   this->nsqpts  = pc->getNumQuadraturePoints();
   this->nsterms = pc->getNumBasisTerms();
-  this->fvals = new TacsScalar[this->nsterms*this->nsqpts];
   this->moment_type = moment_type;
+  if (!moments){
+    moments = new TACSStochasticMoments(this->tacs_comm, pc, quantityType);
+  } else if (moments->getQuantityType() != quantityType){
+    printf("Warning: Shared moments evaluate quantity %d instead of %d\n",
+           moments->getQuantityType(), quantityType);
+  }
+  this->moments = moments;
+  this->moments->incref();
 }
 
 TACSStochasticFMeanFunction::~TACSStochasticFMeanFunction()
 {
   this->dfunc->decref();
-  this->dfunc = NULL;  
+  this->dfunc = NULL;
   this->pc = NULL;
-  delete [] this->fvals;
+  this->moments->decref();
+  this->moments = NULL;
 }
 
 void TACSStochasticFMeanFunction::initEvaluation( EvaluationType ftype )
 {
-  memset(this->fvals, 0 , this->nsterms*this->nsqpts*sizeof(TacsScalar));
+  this->moments->initEvaluation(this);
 }
 
 void TACSStochasticFMeanFunction::finalEvaluation( EvaluationType evalType )
 {
-  TacsScalar temp;
-  for (int q = 0; q < nsterms*nsqpts; q++){
-    temp = fvals[q];
-    MPI_Allreduce(&temp, &fvals[q], 1, TACS_MPI_TYPE, MPI_SUM, this->tacs_comm);
-  }
+  this->moments->finalEvaluation(this);
 }
 
 TacsScalar TACSStochasticFMeanFunction::getFunctionValue(){
@@ -121,31 +55,11 @@ TacsScalar TACSStochasticFMeanFunction::getFunctionValue(){
 }
 
 TacsScalar TACSStochasticFMeanFunction::getExpectation(){
-  // Finish up stochastic integration
-  const int nsparams = pc->getNumParameters();
-  TacsScalar *zq = new TacsScalar[nsparams];
-  TacsScalar *yq = new TacsScalar[nsparams];
-  TacsScalar wq;
-  TacsScalar fmean = 0.0;    
-  for (int q = 0; q < nsqpts; q++){
-    TacsScalar wq = pc->quadrature(q, zq, yq);
-    fmean += wq*pc->basis(0,zq)*fvals[0*nsqpts+q];
-  }
-  delete [] zq;
-  delete [] yq;
-  return fmean;
+  return this->moments->getMoment(1);
 }
 
 TacsScalar TACSStochasticFMeanFunction::getVariance(){
-  TacsScalar fvar = 0.0;
-  for (int k = 1; k < nsterms; k++){
-    TacsScalar fk = 0.0;
-    for (int q = 0; q < nsqpts; q++){
-      fk += fvals[k*nsqpts+q];
-    }
-    fvar += fk*fk;
-  }
-  return fvar;
+  return this->moments->getVariance();
 }
 
 void TACSStochasticFMeanFunction::elementWiseEval( EvaluationType evalType,
@@ -161,65 +75,10 @@ void TACSStochasticFMeanFunction::elementWiseEval( EvaluationType evalType,
   TACSStochasticElement *selem = dynamic_cast<TACSStochasticElement*>(element);
   if (!selem) {
     printf("Casting to stochastic element failed; skipping elemenwiseEval");
+    return;
   };
-  
-  TACSElement *delem = selem->getDeterministicElement();
-  const int nsterms  = pc->getNumBasisTerms();
-  const int nsparams = pc->getNumParameters();
-  const int ndvpn    = delem->getVarsPerNode();
-  const int nsvpn    = selem->getVarsPerNode();
-  const int nddof    = delem->getNumVariables();
-  const int nnodes   = selem->getNumNodes();  
-  
-  // Space for quadrature points and weights
-  TacsScalar *zq = new TacsScalar[nsparams];
-  TacsScalar *yq = new TacsScalar[nsparams];
-  TacsScalar wq;
-  
-  // Create space for deterministic states at each quadrature node in y
-  TacsScalar *uq     = new TacsScalar[nddof];
-  TacsScalar *udq    = new TacsScalar[nddof];
-  TacsScalar *uddq   = new TacsScalar[nddof];
-  
-  // Stochastic Integration
-  for (int j = 0; j < nsterms; j++){
-
-    for (int q = 0; q < nsqpts; q++){
-
-      // Get the quadrature points and weights for mean
-      wq = pc->quadrature(q, zq, yq);
-      
-      // Set the parameter values into the element
-      selem->updateElement(delem, yq);
-
-      // Form the state vectors
-      getDeterministicStates(pc, delem, selem, 
-                             v, dv, ddv, zq, 
-                             uq, udq, uddq);
-
-      { 
-        // spatial and temporal integration
-        double pt[3] = {0.0,0.0,0.0};
-        int N = 1;
-        TacsScalar value = 0.0;
-        int count = delem->evalPointQuantity(elemIndex, 
-                                             this->quantityType,
-                                             time, N, pt,
-                                             Xpts, uq, udq, uddq,
-                                             &value);
-        fvals[j*nsqpts+q] += tscale*value;
-      }
- 
-    } // yq
-
-  } // nsterms
-
-  // clear allocated heap
-  delete [] zq;
-  delete [] yq;
-  delete [] uq;
-  delete [] udq;
-  delete [] uddq;
+  this->moments->addElement(this, elemIndex, selem, time, tscale,
+                            Xpts, v, dv, ddv);
 }
 
 void TACSStochasticFMeanFunction::getElementSVSens( int elemIndex, TACSElement *element,
@@ -234,83 +93,18 @@ void TACSStochasticFMeanFunction::getElementSVSens( int elemIndex, TACSElement *
   TACSStochasticElement *selem = dynamic_cast<TACSStochasticElement*>(element);
   if (!selem) {
     printf("Casting to stochastic element failed; skipping elemenwiseEval");
+    return;
   };
 
-  int numVars = element->getNumVariables();
-  memset(dfdu, 0, numVars*sizeof(TacsScalar));
-  
-  TACSElement *delem = selem->getDeterministicElement();
-  const int nsterms  = pc->getNumBasisTerms();
-  const int nsparams = pc->getNumParameters();
-  const int ndvpn    = delem->getVarsPerNode();
-  const int nsvpn    = selem->getVarsPerNode();
-  const int nddof    = delem->getNumVariables();
-  const int nnodes   = selem->getNumNodes();  
-
-  // j-th project
-  TacsScalar *dfduj  = new TacsScalar[nddof];  
-  
-  // Space for quadrature points and weights
-  TacsScalar *zq = new TacsScalar[nsparams];
-  TacsScalar *yq = new TacsScalar[nsparams];
-  TacsScalar wq;
-  
-  // Create space for deterministic states at each quadrature node in y
-  TacsScalar *uq     = new TacsScalar[nddof];
-  TacsScalar *udq    = new TacsScalar[nddof];
-  TacsScalar *uddq   = new TacsScalar[nddof];
-
-  for (int j = 0; j < nsterms; j++){
-
-    memset(dfduj, 0, nddof*sizeof(TacsScalar));
-    
-    // Stochastic Integration
-    for (int q = 0; q < nsqpts; q++){
-
-      // Get the quadrature points and weights for mean
-      wq = pc->quadrature(q, zq, yq);
-      TacsScalar wt = pc->basis(j,zq)*wq;
-    
-      // Set the parameter values into the element
-      selem->updateElement(delem, yq);
-
-      // Form the state vectors
-      getDeterministicStates(pc, delem, selem, 
-                             v, dv, ddv, zq, 
-                             uq, udq, uddq);
-
-      { 
-        double pt[3] = {0.0,0.0,0.0};
-        int N = 1;
-        TacsScalar _dfdq = 1.0;      
-        delem->addPointQuantitySVSens(elemIndex,
-                                      this->quantityType,
-                                      time, wt*alpha, wt*beta, wt*gamma,
-                                      N, pt,
-                                      Xpts, uq, udq, uddq, &_dfdq, 
-                                      dfduj); // store into tmp
-      }
-
-    } // end yloop
-    
-    // Store j-th projected sv sens into stochastic array
-    for (int n = 0; n < nnodes; n++){
-      int lptr = n*ndvpn;
-      int gptr = n*nsvpn + j*ndvpn;
-      for (int d = 0; d < ndvpn; d++){        
-        dfdu[gptr+d] = dfduj[lptr+d];
-      }
-    }
-
-  } // end nsterms
+  // Derivative of E[f] w.r.t. the value at each quadrature point
+  TACSStochasticWorkspace::Frame work;
+  TacsScalar *dfdq = work.allocate(nsqpts);
+  const TacsScalar coef[1] = {1.0};
+  this->moments->getMomentSens(1, coef, dfdq);
 
-  // clear allocated heap
-  delete [] dfduj;
-  delete [] zq;
-  delete [] yq;
-  delete [] uq;
-  delete [] udq;
-  delete [] uddq;
+  this->moments->getElementSVSens(elemIndex, selem, time,
+                                  alpha, beta, gamma,
+                                  Xpts, v, dv, ddv, dfdq, dfdu);
 }
 
 void TACSStochasticFMeanFunction::addElementDVSens( int elemIndex, TACSElement *element,
@@ -322,87 +116,15 @@ void TACSStochasticFMeanFunction::addElementDVSens( int elemIndex, TACSElement *
   TACSStochasticElement *selem = dynamic_cast<TACSStochasticElement*>(element);
   if (!selem) {
     printf("Casting to stochastic element failed; skipping elemenwiseEval");
+    return;
   };
-  TACSElement *delem = selem->getDeterministicElement();
-
-  const int nsterms  = pc->getNumBasisTerms();
-  const int nsparams = pc->getNumParameters();
-  const int ndvpn    = delem->getVarsPerNode();
-  const int nsvpn    = selem->getVarsPerNode();
-  const int nddof    = delem->getNumVariables();
-  const int nnodes   = selem->getNumNodes();  
-  const int dvpernode = delem->getDesignVarsPerNode();
-
-  // j-th projection of dfdx array
-  TacsScalar *dfdxj  = new TacsScalar[dvLen];
-  
-  // Space for quadrature points and weights
-  TacsScalar *zq = new TacsScalar[nsparams];
-  TacsScalar *yq = new TacsScalar[nsparams];
-  TacsScalar wq;
-  
-  // Create space for deterministic states at each quadrature node in y
-  TacsScalar *uq     = new TacsScalar[nddof];
-  TacsScalar *udq    = new TacsScalar[nddof];
-  TacsScalar *uddq   = new TacsScalar[nddof];
-  
-  // int nterms;
-  // if (moment_type == 0){
-  //   nterms = 1;
-  // } else {
-  //   nterms = 
-  // }
-
-  for (int j = 0; j < 1; j++){ 
-
-    memset(dfdxj, 0, dvLen*sizeof(TacsScalar));
-    
-    // Stochastic Integration
-    for (int q = 0; q < nsqpts; q++){
-
-      // Get the quadrature points and weights for mean
-      wq = pc->quadrature(q, zq, yq);
-      TacsScalar wt = pc->basis(j,zq)*wq;
-    
-      // Set the parameter values into the element
-      selem->updateElement(delem, yq);
-
-      // form deterministic states      
-      getDeterministicStates(pc, delem, selem, v, dv, ddv, zq, uq, udq, uddq);
-
-      // Call the underlying element and get the state variable sensitivities
-      double pt[3] = {0.0,0.0,0.0};
-      int N = 1;
-      TacsScalar _dfdq = 1.0; 
-      delem->addPointQuantityDVSens( elemIndex, 
-                                     this->quantityType,
-                                     time, wt*scale,
-                                     N, pt,
-                                     Xpts, uq, udq, uddq, &_dfdq, 
-                                     dvLen, dfdxj ); 
-    } // end yloop
-
-    // for (int n = 0; n < nnodes; n++){
-    //   int lptr = n*dvpernode;
-    //   int gptr = n*dvpernode + j*dvpernode;
-    //   for (int i = 0; i < dvpernode; i++){
-    //     dfdx[gptr+n] += dfdxj[lptr+n];
-    //   }            
-    // }
 
-    // need to be careful with nodewise placement of dvsx
-    for (int n = 0; n < dvLen; n++){
-      //      printf("term %d dfdx[%d] = %.17e %.17e \n", j, n, dfdx[n], dfdxj[n]);
-      dfdx[n] += dfdxj[n];
-    }
-    
-  } // end nsterms
+  // Derivative of E[f] w.r.t. the value at each quadrature point
+  TACSStochasticWorkspace::Frame work;
+  TacsScalar *dfdq = work.allocate(nsqpts);
+  const TacsScalar coef[1] = {1.0};
+  this->moments->getMomentSens(1, coef, dfdq);
 
-  // clear allocated heap
-  delete [] zq;
-  delete [] yq;
-  delete [] uq;
-  delete [] udq;
-  delete [] uddq;
-  delete [] dfdxj;
+  this->moments->addElementDVSens(elemIndex, selem, time, scale,
+                                  Xpts, v, dv, ddv, dfdq, dvLen, dfdx);
 }
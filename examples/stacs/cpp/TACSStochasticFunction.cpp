@@ -2,76 +2,6 @@
 #include "TACSStochasticFunction.h"
 #include "TACSStochasticElement.h"
 
-namespace {
-  void getDeterministicAdjoint( ParameterContainer *pc, 
-                                TACSElement *delem,
-                                TACSElement *selem, 
-                                const TacsScalar v[],
-                                TacsScalar *zq,
-                                TacsScalar *uq
-                                ){
-    int ndvpn   = delem->getVarsPerNode();
-    int nsvpn   = selem->getVarsPerNode();
-    int nddof   = delem->getNumVariables();
-    int nsdof   = selem->getNumVariables();
-    int nsterms = pc->getNumBasisTerms();
-    int nnodes  = selem->getNumNodes();
-    
-    memset(uq  , 0, nddof*sizeof(TacsScalar));
-
-    // Evaluate the basis at quadrature node and form the state
-    // vectors
-    for (int n = 0; n < nnodes; n++){
-      for (int k = 0; k < nsterms; k++){
-        TacsScalar psikz = pc->basis(k,zq);
-        int lptr = n*ndvpn;
-        int gptr = n*nsvpn + k*ndvpn;
-        for (int d = 0; d < ndvpn; d++){        
-          uq[lptr+d] += v[gptr+d]*psikz;
-        }
-      }
-    }
-  } 
-
-  void getDeterministicStates( ParameterContainer *pc, 
-                               TACSElement *delem,
-                               TACSElement *selem, 
-                               const TacsScalar v[],
-                               const TacsScalar dv[],
-                               const TacsScalar ddv[], 
-                               TacsScalar *zq,
-                               TacsScalar *uq,
-                               TacsScalar *udq,
-                               TacsScalar *uddq
-                               ){
-    int ndvpn   = delem->getVarsPerNode();
-    int nsvpn   = selem->getVarsPerNode();
-    int nddof   = delem->getNumVariables();
-    int nsdof   = selem->getNumVariables();
-    int nsterms = pc->getNumBasisTerms();
-    int nnodes  = selem->getNumNodes();
-
-    memset(uq  , 0, nddof*sizeof(TacsScalar));
-    memset(udq , 0, nddof*sizeof(TacsScalar));
-    memset(uddq, 0, nddof*sizeof(TacsScalar));
-
-    // Evaluate the basis at quadrature node and form the state
-    // vectors
-    for (int n = 0; n < nnodes; n++){
-      for (int k = 0; k < nsterms; k++){
-        TacsScalar psikz = pc->basis(k,zq);
-        int lptr = n*ndvpn;
-        int gptr = n*nsvpn + k*ndvpn;
-        for (int d = 0; d < ndvpn; d++){        
-          uq[lptr+d] += v[gptr+d]*psikz;
-          udq[lptr+d] += dv[gptr+d]*psikz;
-          uddq[lptr+d] += ddv[gptr+d]*psikz;
-        }
-      }
-    }
-  } 
-}
-
 TACSStochasticFunction::TACSStochasticFunction( TACSAssembler *tacs,
                                                 TACSFunction *dfunc,
                                                 ParameterContainer *pc,
@@ -91,15 +21,18 @@ TACSStochasticFunction::TACSStochasticFunction( TACSAssembler *tacs,
   this->nsqpts  = pc->getNumQuadraturePoints();
   this->nsterms = pc->getNumBasisTerms();
   this->fvals   = new TacsScalar[nsterms*nsqpts];
+  this->reduction = new TACSStochasticReduction(this->tacs_comm);
 }
 
 TACSStochasticFunction::~TACSStochasticFunction()
 {
+  delete this->reduction;
   delete [] this->fvals;
 }
 
 void TACSStochasticFunction::initEvaluation( EvaluationType ftype )
 {
+  this->reduction->wait();
   memset(fvals, 0.0, nsqpts*nsterms*sizeof(TacsScalar));
 }
 
@@ -126,15 +59,19 @@ void TACSStochasticFunction::elementWiseEval( EvaluationType evalType,
   const int nddof    = delem->getNumVariables();
   const int nnodes   = selem->getNumNodes();  
   
+  // Scratch arrays are taken from the workspace of this thread
+  TACSStochasticWorkspace::Frame work;
+
   // Space for quadrature points and weights
-  TacsScalar *zq = new TacsScalar[nsparams];
-  TacsScalar *yq = new TacsScalar[nsparams];
+  TacsScalar *zq = work.allocate(nsparams);
+  TacsScalar *yq = work.allocate(nsparams);
   TacsScalar wq;
   
-  // Create space for deterministic states at each quadrature node in y
-  TacsScalar *uq     = new TacsScalar[nddof];
-  TacsScalar *udq    = new TacsScalar[nddof];
-  TacsScalar *uddq   = new TacsScalar[nddof];
+  // Deterministic states at every quadrature node in y, reconstructed
+  // from the stochastic states in one product
+  TacsScalar *uc     = work.allocate(3*pc->getNumQuadraturePoints()*nddof);
+  const TacsScalar *vecs[3] = {v, dv, ddv};
+  selem->getDeterministicStates(0, pc->getNumQuadraturePoints(), 3, vecs, uc);
 
   for (int j = 0; j < nsterms; j++){
 
@@ -145,12 +82,12 @@ void TACSStochasticFunction::elementWiseEval( EvaluationType evalType,
       wq = pc->quadrature(q, zq, yq);
 
       // Set the parameter values into the element
-      selem->updateElement(delem, yq);
+      TACSElement *qelem = selem->getParameterizedElement(q, delem, yq);
 
       // Form the state vectors
-      getDeterministicStates(pc, delem, selem, 
-                             v, dv, ddv, zq, 
-                             uq, udq, uddq);
+      const TacsScalar *uq   = &uc[3*q*nddof];
+      const TacsScalar *udq  = &uq[nddof];
+      const TacsScalar *uddq = &uq[2*nddof];
 
       {
         TACSElementBasis *basis = delem->getElementBasis();
@@ -163,7 +100,7 @@ void TACSStochasticFunction::elementWiseEval( EvaluationType evalType,
             double weight = basis->getQuadraturePoint(i, pt);
             
             TacsScalar value = 0.0;
-            int count = delem->evalPointQuantity(elemIndex,
+            int count = qelem->evalPointQuantity(elemIndex,
                                                  this->quantityType,
                                                  time, i, pt,
                                                  Xpts, uq, udq, uddq,
@@ -185,32 +122,36 @@ void TACSStochasticFunction::elementWiseEval( EvaluationType evalType,
     } // end yloop
 
   } // nsterms
-
-  // clear allocated heap
-  delete [] zq;
-  delete [] yq;
-  delete [] uq;
-  delete [] udq;
-  delete [] uddq;
 }
 
 void TACSStochasticFunction::finalEvaluation( EvaluationType evalType )
 {
-  TacsScalar temp;
-  for (int q = 0; q < nsterms*nsqpts; q++){
-    temp = fvals[q];
-    MPI_Allreduce(&temp, &fvals[q], 1, TACS_MPI_TYPE, MPI_SUM, this->tacs_comm);
-  }
+  // Reduce the whole buffer in one collective
+  this->reduction->allreduce(fvals, nsterms*nsqpts, MPI_SUM);
+}
+
+/*
+  Overlap the reductions over the processors with the next function
+*/
+void TACSStochasticFunction::setNonblockingReduction( int flag )
+{
+  this->reduction->setNonblocking(flag);
 }
 
 /**
    Get the value of the function
 */
 TacsScalar TACSStochasticFunction::getFunctionValue(){ 
+  this->reduction->wait();
+
   // Finish up stochastic integration
   const int nsparams = pc->getNumParameters();
-  TacsScalar *zq = new TacsScalar[nsparams];
-  TacsScalar *yq = new TacsScalar[nsparams];
+
+  // Scratch arrays are taken from the workspace of this thread
+  TACSStochasticWorkspace::Frame work;
+
+  TacsScalar *zq = work.allocate(nsparams);
+  TacsScalar *yq = work.allocate(nsparams);
   TacsScalar wq;
   
   // Compute mean
@@ -227,8 +168,6 @@ TacsScalar TACSStochasticFunction::getFunctionValue(){
       ffmean += wq*pc->basis(0,zq)*fvals[0*nsqpts+q]*fvals[0*nsqpts+q];
     }
   }
-  delete [] zq;
-  delete [] yq;
   
   if (moment_type == FUNCTION_MEAN1) {
     return fmean;
@@ -246,6 +185,8 @@ void TACSStochasticFunction::getElementSVSens( int elemIndex, TACSElement *eleme
                                                const TacsScalar dv[],
                                                const TacsScalar ddv[],
                                                TacsScalar dfdu[] ){
+  this->reduction->wait();
+
   TACSStochasticElement *selem = dynamic_cast<TACSStochasticElement*>(element);
   if (!selem) {
     printf("Casting to stochastic element failed; skipping elemenwiseEval");
@@ -261,18 +202,22 @@ void TACSStochasticFunction::getElementSVSens( int elemIndex, TACSElement *eleme
   const int nsdof    = selem->getNumVariables();
   memset(dfdu, 0, nsdof*sizeof(TacsScalar));
 
+  // Scratch arrays are taken from the workspace of this thread
+  TACSStochasticWorkspace::Frame work;
+
   // j-th project
-  TacsScalar *dfduj  = new TacsScalar[nddof];  
+  TacsScalar *dfduj  = work.allocate(nddof);  
   
   // Space for quadrature points and weights
-  TacsScalar *zq = new TacsScalar[nsparams];
-  TacsScalar *yq = new TacsScalar[nsparams];
+  TacsScalar *zq = work.allocate(nsparams);
+  TacsScalar *yq = work.allocate(nsparams);
   TacsScalar wq;
   
-  // Create space for deterministic states at each quadrature node in y
-  TacsScalar *uq     = new TacsScalar[nddof];
-  TacsScalar *udq    = new TacsScalar[nddof];
-  TacsScalar *uddq   = new TacsScalar[nddof];
+  // Deterministic states at every quadrature node in y, reconstructed
+  // from the stochastic states in one product
+  TacsScalar *uc     = work.allocate(3*pc->getNumQuadraturePoints()*nddof);
+  const TacsScalar *vecs[3] = {v, dv, ddv};
+  selem->getDeterministicStates(0, pc->getNumQuadraturePoints(), 3, vecs, uc);
 
   for (int j = 0; j < nsterms; j++){
 
@@ -286,12 +231,12 @@ void TACSStochasticFunction::getElementSVSens( int elemIndex, TACSElement *eleme
       TacsScalar wt = pc->basis(j,zq)*wq;
     
       // Set the parameter values into the element
-      selem->updateElement(delem, yq);
+      TACSElement *qelem = selem->getParameterizedElement(q, delem, yq);
 
       // Form the state vectors
-      getDeterministicStates(pc, delem, selem, 
-                             v, dv, ddv, zq, 
-                             uq, udq, uddq);
+      const TacsScalar *uq   = &uc[3*q*nddof];
+      const TacsScalar *udq  = &uq[nddof];
+      const TacsScalar *uddq = &uq[2*nddof];
 
       { 
 
@@ -306,7 +251,7 @@ void TACSStochasticFunction::getElementSVSens( int elemIndex, TACSElement *eleme
             double weight = basis->getQuadraturePoint(i, pt);
       
             TacsScalar quantity = 0.0;
-            delem->evalPointQuantity(elemIndex,
+            qelem->evalPointQuantity(elemIndex,
                                      this->quantityType,
                                      time, i, pt,
                                      Xpts, uq, udq, uddq,
@@ -321,7 +266,7 @@ void TACSStochasticFunction::getElementSVSens( int elemIndex, TACSElement *eleme
               ksPtWeight *= 2.0*fvals[j*nsqpts+q];
             }
             TacsScalar dfdq = ksPtWeight;
-            delem->addPointQuantitySVSens(elemIndex,
+            qelem->addPointQuantitySVSens(elemIndex,
                                           this->quantityType,
                                           time,
                                           alpha, beta, gamma,
@@ -347,14 +292,6 @@ void TACSStochasticFunction::getElementSVSens( int elemIndex, TACSElement *eleme
     }
 
   } // end nsterms
-
-  // clear allocated heap
-  delete [] dfduj;
-  delete [] zq;
-  delete [] yq;
-  delete [] uq;
-  delete [] udq;
-  delete [] uddq; 
 }
 
 void TACSStochasticFunction::addElementDVSens( int elemIndex, TACSElement *element,
@@ -365,7 +302,7 @@ void TACSStochasticFunction::addElementDVSens( int elemIndex, TACSElement *eleme
                                                const TacsScalar ddv[],
                                                int dvLen,
                                                TacsScalar dfdx[] ){
-
+  this->reduction->wait();
 
   TACSStochasticElement *selem = dynamic_cast<TACSStochasticElement*>(element);
   if (!selem) {
@@ -381,18 +318,22 @@ void TACSStochasticFunction::addElementDVSens( int elemIndex, TACSElement *eleme
   const int nnodes    = selem->getNumNodes();  
   const int dvpernode = delem->getDesignVarsPerNode();
 
+  // Scratch arrays are taken from the workspace of this thread
+  TACSStochasticWorkspace::Frame work;
+
   // j-th projection of dfdx array
-  TacsScalar *dfdxj  = new TacsScalar[dvLen];
+  TacsScalar *dfdxj  = work.allocate(dvLen);
   
   // Space for quadrature points and weights
-  TacsScalar *zq = new TacsScalar[nsparams];
-  TacsScalar *yq = new TacsScalar[nsparams];
+  TacsScalar *zq = work.allocate(nsparams);
+  TacsScalar *yq = work.allocate(nsparams);
   TacsScalar wq;
   
-  // Create space for deterministic states at each quadrature node in y
-  TacsScalar *uq     = new TacsScalar[nddof];
-  TacsScalar *udq    = new TacsScalar[nddof];
-  TacsScalar *uddq   = new TacsScalar[nddof];
+  // Deterministic states at every quadrature node in y, reconstructed
+  // from the stochastic states in one product
+  TacsScalar *uc     = work.allocate(3*pc->getNumQuadraturePoints()*nddof);
+  const TacsScalar *vecs[3] = {v, dv, ddv};
+  selem->getDeterministicStates(0, pc->getNumQuadraturePoints(), 3, vecs, uc);
   
   for (int j = 0; j < 1; j++){
 
@@ -406,10 +347,12 @@ void TACSStochasticFunction::addElementDVSens( int elemIndex, TACSElement *eleme
       TacsScalar wt = pc->basis(j,zq)*wq;
     
       // Set the parameter values into the element
-      selem->updateElement(delem, yq);
+      TACSElement *qelem = selem->getParameterizedElement(q, delem, yq);
 
       // form deterministic states      
-      getDeterministicStates(pc, delem, selem, v, dv, ddv, zq, uq, udq, uddq);
+      const TacsScalar *uq   = &uc[3*q*nddof];
+      const TacsScalar *udq  = &uq[nddof];
+      const TacsScalar *uddq = &uq[2*nddof];
 
       {
         TACSElementBasis *basis = delem->getElementBasis();
@@ -422,7 +365,7 @@ void TACSStochasticFunction::addElementDVSens( int elemIndex, TACSElement *eleme
             double weight = basis->getQuadraturePoint(i, pt);
 
             TacsScalar quantity = 0.0;
-            delem->evalPointQuantity(elemIndex,
+            qelem->evalPointQuantity(elemIndex,
                                      this->quantityType,
                                      time, i, pt,
                                      Xpts, uq, udq, uddq,
@@ -436,7 +379,7 @@ void TACSStochasticFunction::addElementDVSens( int elemIndex, TACSElement *eleme
             if (moment_type == 1){
               dfdq *= 2.0*fvals[j*nsqpts+q];
             }
-            delem->addPointQuantityDVSens( elemIndex, 
+            qelem->addPointQuantityDVSens( elemIndex, 
                                            this->quantityType,
                                            time, scale,
                                            i, pt,
@@ -467,12 +410,4 @@ void TACSStochasticFunction::addElementDVSens( int elemIndex, TACSElement *eleme
     }
     
   } // end nsterms
-
-  // clear allocated heap
-  delete [] zq;
-  delete [] yq;
-  delete [] uq;
-  delete [] udq;
-  delete [] uddq;
-  delete [] dfdxj;
 }
@@ -3,6 +3,7 @@
 
 #include "TACSFunction.h"
 #include "ParameterContainer.h"
+#include "TACSStochasticReduction.h"
 
 // Define some quantities of interest
 static const int FUNCTION_MEAN1   = 0;
@@ -16,6 +17,9 @@ class TACSStochasticFunction : public TACSFunction {
                           int quantityType,
                           int moment_type );
   ~TACSStochasticFunction();
+
+  // Overlap the reductions over the processors with the next function
+  void setNonblockingReduction( int flag );
   /**
      Get the object name
   */
@@ -198,6 +202,9 @@ class TACSStochasticFunction : public TACSFunction {
   int nsterms;
 
   MPI_Comm tacs_comm;
+
+  // Reduction of the values at the quadrature points
+  TACSStochasticReduction *reduction;
 };
 
 #endif
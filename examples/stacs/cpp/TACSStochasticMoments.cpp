@@ -0,0 +1,574 @@
+#include "TACSStochasticMoments.h"
+#include "TACSStochasticElement.h"
+#include "MatrixKernels.h"
+
+namespace{
+  /*
+    Evaluate the quantity of interest for the deterministic states
+    u = [vars, dvars, ddvars] stored contiguously
+  */
+  TacsScalar evalQuantity( TACSElement *elem, int elemIndex,
+                           int quantityType, double time,
+                           const TacsScalar Xpts[], const TacsScalar *u ){
+    const int nddof = elem->getNumVariables();
+    double pt[3] = {0.0, 0.0, 0.0};
+    int N = 1;
+    TacsScalar value = 0.0;
+    elem->evalPointQuantity(elemIndex, quantityType, time, N, pt,
+                            Xpts, u, &u[nddof], &u[2*nddof], &value);
+    return value;
+  }
+
+  /*
+    Derivative of a statistic w.r.t. the projections of the quantity,
+    dF/df_k = sum_q psi_k(z_q) dF/df_q, used in linear mode
+  */
+  void getCoefficientSens( ParameterContainer *pc, const TacsScalar dfdq[],
+                           TacsScalar dfdk[] ){
+    const int nsterms = pc->getNumBasisTerms();
+    const int nsqpts = pc->getNumQuadraturePoints();
+    for (int k = 0; k < nsterms; k++){
+      const TacsScalar *psik = pc->getBasisRow(k);
+      dfdk[k] = 0.0;
+      for (int q = 0; q < nsqpts; q++){
+        dfdk[k] += psik[q]*dfdq[q];
+      }
+    }
+  }
+}
+
+/*
+  Constructor
+
+  @param comm the communicator of the assembler
+  @param pc the parameter container defining the quadrature
+  @param quantityType the quantity of interest evaluated by the elements
+*/
+TACSStochasticMoments::TACSStochasticMoments( MPI_Comm comm,
+                                              ParameterContainer *pc,
+                                              int quantityType ){
+  this->pc = pc;
+  this->quantityType = quantityType;
+  this->nsqpts = pc->getNumQuadraturePoints();
+  this->nsterms = pc->getNumBasisTerms();
+  this->fvals = new TacsScalar[this->nsqpts];
+  memset(this->fvals, 0, this->nsqpts*sizeof(TacsScalar));
+  this->linear = 0;
+  this->fvals_stale = 0;
+  this->fcoef = new TacsScalar[this->nsterms];
+  memset(this->fcoef, 0, this->nsterms*sizeof(TacsScalar));
+  this->owner = NULL;
+  this->reduction = new TACSStochasticReduction(comm);
+}
+
+/*
+  Destructor
+*/
+TACSStochasticMoments::~TACSStochasticMoments(){
+  this->pc = NULL;
+  delete this->reduction;
+  delete [] this->fvals;
+  delete [] this->fcoef;
+}
+
+/*
+  Return the quantity of interest of the engine
+*/
+int TACSStochasticMoments::getQuantityType(){
+  return this->quantityType;
+}
+
+/*
+  Overlap the reduction over the processors with the next function
+*/
+void TACSStochasticMoments::setNonblockingReduction( int flag ){
+  this->reduction->setNonblocking(flag);
+}
+
+/*
+  Take the moments from the projected coefficients of the quantity
+  (off by default). Only valid when the quantity is affine in the
+  states and independent of the parameters, e.g. a displacement or a
+  linear strain measure, but not a KS aggregate or a stress of an
+  element with random stiffness.
+
+  @param flag 1 to evaluate the quantity once per basis term
+*/
+void TACSStochasticMoments::setLinearQuantity( int flag ){
+  this->reduction->wait();
+  this->linear = flag;
+}
+
+/*
+  Open an evaluation. The first view to initialize after the previous
+  evaluation was finalized clears and accumulates the values; the
+  calls of the other views sharing the engine have no effect.
+
+  @param view the function view requesting the evaluation
+*/
+void TACSStochasticMoments::initEvaluation( const void *view ){
+  if (!this->owner){
+    this->reduction->wait();
+    memset(this->fvals, 0, this->nsqpts*sizeof(TacsScalar));
+    memset(this->fcoef, 0, this->nsterms*sizeof(TacsScalar));
+    this->fvals_stale = this->linear;
+    this->owner = view;
+  }
+}
+
+/*
+  Add the contribution of one element to the values at the quadrature
+  points. The states are reconstructed at all points at once and the
+  quantity is evaluated once per point. In linear mode the quantity is
+  evaluated once per basis term on the projected states instead.
+
+  @param view the function view integrating the element
+  @param elemIndex the local element index
+  @param selem the stochastic element
+  @param time the simulation time
+  @param scale the integration factor to apply
+  @param Xpts the element node locations
+  @param v the stochastic element states
+  @param dv the first time derivatives of the states
+  @param ddv the second time derivatives of the states
+*/
+void TACSStochasticMoments::addElement( const void *view,
+                                        int elemIndex,
+                                        TACSStochasticElement *selem,
+                                        double time, TacsScalar scale,
+                                        const TacsScalar Xpts[],
+                                        const TacsScalar v[],
+                                        const TacsScalar dv[],
+                                        const TacsScalar ddv[] ){
+  if (view != this->owner){
+    return;
+  }
+
+  TACSElement *delem = selem->getDeterministicElement();
+  const int nsparams = pc->getNumParameters();
+  const int nddof    = delem->getNumVariables();
+
+  // Scratch arrays are taken from the workspace of this thread
+  TACSStochasticWorkspace::Frame work;
+  TacsScalar *zq = work.allocate(nsparams);
+  TacsScalar *yq = work.allocate(nsparams);
+
+  const TacsScalar *vecs[3] = {v, dv, ddv};
+
+  if (this->linear){
+    // Projections f_0 = f(u_0) and f_k = f(u_k) - f(0) of the quantity
+    TacsScalar *uk = work.allocate(3*nsterms*nddof);
+    selem->getCoefficientStates(3, vecs, uk);
+    TacsScalar *u0 = work.allocate(3*nddof);
+    memset(u0, 0, 3*nddof*sizeof(TacsScalar));
+    TacsScalar f0 = evalQuantity(delem, elemIndex, this->quantityType,
+                                 time, Xpts, u0);
+    for (int k = 0; k < nsterms; k++){
+      TacsScalar fk = evalQuantity(delem, elemIndex, this->quantityType,
+                                   time, Xpts, &uk[3*k*nddof]);
+      if (k > 0){
+        fk -= f0;
+      }
+      fcoef[k] += scale*fk;
+    }
+    return;
+  }
+
+  // Deterministic states at every quadrature node in y
+  TacsScalar *uc = work.allocate(3*nsqpts*nddof);
+  selem->getDeterministicStates(0, nsqpts, 3, vecs, uc);
+
+  for (int q = 0; q < nsqpts; q++){
+    pc->quadrature(q, zq, yq);
+    TACSElement *qelem = selem->getParameterizedElement(q, delem, yq);
+
+    const TacsScalar *uq   = &uc[3*q*nddof];
+    const TacsScalar *udq  = &uq[nddof];
+    const TacsScalar *uddq = &uq[2*nddof];
+
+    double pt[3] = {0.0, 0.0, 0.0};
+    int N = 1;
+    TacsScalar value = 0.0;
+    qelem->evalPointQuantity(elemIndex, this->quantityType,
+                             time, N, pt,
+                             Xpts, uq, udq, uddq,
+                             &value);
+    fvals[q] += scale*value;
+  }
+}
+
+/*
+  Close the evaluation: the values of the accumulating view are
+  summed over all processors in one collective, which is only
+  started in nonblocking mode.
+
+  @param view the function view finalizing the evaluation
+*/
+void TACSStochasticMoments::finalEvaluation( const void *view ){
+  if (view == this->owner){
+    if (this->linear){
+      this->reduction->allreduce(this->fcoef, this->nsterms, MPI_SUM);
+    } else {
+      this->reduction->allreduce(this->fvals, this->nsqpts, MPI_SUM);
+    }
+    this->owner = NULL;
+  }
+}
+
+/*
+  Complete the reduction and, in linear mode, reconstruct the values
+  at the quadrature points f_q = sum_k f_k psi_k(z_q) on first use
+*/
+void TACSStochasticMoments::updatePointValues(){
+  this->reduction->wait();
+  if (this->fvals_stale){
+    memset(fvals, 0, nsqpts*sizeof(TacsScalar));
+    for (int k = 0; k < nsterms; k++){
+      const TacsScalar *psik = pc->getBasisRow(k);
+      for (int q = 0; q < nsqpts; q++){
+        fvals[q] += fcoef[k]*psik[q];
+      }
+    }
+    this->fvals_stale = 0;
+  }
+}
+
+/*
+  Return the domain integrated quantity at each quadrature point
+*/
+const TacsScalar* TACSStochasticMoments::getPointValues(){
+  updatePointValues();
+  return this->fvals;
+}
+
+/*
+  Compute the raw moments E[f], E[f^2], ... E[f^nmoments] together in
+  one pass over the quadrature points. In linear mode the first two
+  are E[f] = f_0 and E[f^2] = f_0^2 + sum_{k>0} f_k^2.
+
+  @param nmoments the number of moments
+  @param moments returns the raw moments
+*/
+void TACSStochasticMoments::getMoments( int nmoments,
+                                        TacsScalar moments[] ){
+  if (this->linear && nmoments > 0 && nmoments <= 2){
+    this->reduction->wait();
+    TacsScalar fmean = pc->getMean(fcoef);
+    moments[0] = fmean;
+    if (nmoments > 1){
+      moments[1] = fmean*fmean + pc->getVariance(fcoef);
+    }
+    return;
+  }
+  updatePointValues();
+  const TacsScalar *wpsi0 = pc->getWeightedBasisRow(0);
+  memset(moments, 0, nmoments*sizeof(TacsScalar));
+  for (int q = 0; q < nsqpts; q++){
+    TacsScalar fm = wpsi0[q];
+    for (int m = 0; m < nmoments; m++){
+      fm *= fvals[q];
+      moments[m] += fm;
+    }
+  }
+}
+
+/*
+  Return the raw moment E[f^m]
+*/
+TacsScalar TACSStochasticMoments::getMoment( int m ){
+  if (m < 1){
+    return 1.0;
+  }
+  TACSStochasticWorkspace::Frame work;
+  TacsScalar *moments = work.allocate(m);
+  getMoments(m, moments);
+  return moments[m-1];
+}
+
+/*
+  Return the projection f_k of the quantity on the k-th basis term
+*/
+TacsScalar TACSStochasticMoments::getProjection( int k ){
+  this->reduction->wait();
+  if (this->linear){
+    return fcoef[k];
+  }
+  const TacsScalar *wpsik = pc->getWeightedBasisRow(k);
+  TacsScalar fk = 0.0;
+  for (int q = 0; q < nsqpts; q++){
+    fk += wpsik[q]*fvals[q];
+  }
+  return fk;
+}
+
+/*
+  Return the variance of the projection, the sum of the squares of
+  the projections on the basis terms other than the mean
+*/
+TacsScalar TACSStochasticMoments::getVariance(){
+  if (this->linear){
+    this->reduction->wait();
+    return pc->getVariance(fcoef);
+  }
+  TacsScalar fvar = 0.0;
+  for (int k = 1; k < nsterms; k++){
+    TacsScalar fk = getProjection(k);
+    fvar += fk*fk;
+  }
+  return fvar;
+}
+
+/*
+  Return the covariance of the quantities of two engines on the same
+  parameter container, sum_{k>0} f_k g_k
+
+  @param other the engine of the second quantity
+*/
+TacsScalar TACSStochasticMoments::getCovariance( TACSStochasticMoments *other ){
+  TACSStochasticWorkspace::Frame work;
+  TacsScalar *fk = work.allocate(nsterms);
+  TacsScalar *gk = work.allocate(nsterms);
+  for (int k = 0; k < nsterms; k++){
+    fk[k] = getProjection(k);
+    gk[k] = other->getProjection(k);
+  }
+  return pc->getCovariance(fk, gk);
+}
+
+/*
+  Derivative of the combination of raw moments
+  F = sum_m coef[m-1]*E[f^m] w.r.t. the value at each quadrature point
+
+  @param nmoments the number of moments in the combination
+  @param coef the coefficients of the moments
+  @param dfdq returns dF/df_q
+*/
+void TACSStochasticMoments::getMomentSens( int nmoments,
+                                           const TacsScalar coef[],
+                                           TacsScalar dfdq[] ){
+  updatePointValues();
+  const TacsScalar *wpsi0 = pc->getWeightedBasisRow(0);
+  for (int q = 0; q < nsqpts; q++){
+    TacsScalar fm = wpsi0[q];
+    dfdq[q] = 0.0;
+    for (int m = 0; m < nmoments; m++){
+      dfdq[q] += TacsScalar(m+1)*coef[m]*fm;
+      fm *= fvals[q];
+    }
+  }
+}
+
+/*
+  Derivative of the variance of the projection w.r.t. the value at
+  each quadrature point
+
+  @param dfdq returns dF/df_q
+*/
+void TACSStochasticMoments::getVarianceSens( TacsScalar dfdq[] ){
+  memset(dfdq, 0, nsqpts*sizeof(TacsScalar));
+  for (int k = 1; k < nsterms; k++){
+    const TacsScalar *wpsik = pc->getWeightedBasisRow(k);
+    TacsScalar fk = getProjection(k);
+    for (int q = 0; q < nsqpts; q++){
+      dfdq[q] += 2.0*fk*wpsik[q];
+    }
+  }
+}
+
+/*
+  Derivative of a statistic w.r.t. the stochastic states of an element.
+  The point sensitivities weighted by dF/df_q are evaluated once per
+  quadrature point and projected on all basis terms in one product.
+  In linear mode they are evaluated once per basis term instead.
+
+  @param elemIndex the local element index
+  @param selem the stochastic element
+  @param time the simulation time
+  @param alpha coefficient for the state derivative
+  @param beta coefficient for the first time derivative
+  @param gamma coefficient for the second time derivative
+  @param Xpts the element node locations
+  @param v the stochastic element states
+  @param dv the first time derivatives of the states
+  @param ddv the second time derivatives of the states
+  @param dfdq the derivative of the statistic w.r.t. each f_q
+  @param dfdu returns the derivative w.r.t. the stochastic states
+*/
+void TACSStochasticMoments::getElementSVSens( int elemIndex,
+                                              TACSStochasticElement *selem,
+                                              double time,
+                                              TacsScalar alpha,
+                                              TacsScalar beta,
+                                              TacsScalar gamma,
+                                              const TacsScalar Xpts[],
+                                              const TacsScalar v[],
+                                              const TacsScalar dv[],
+                                              const TacsScalar ddv[],
+                                              const TacsScalar dfdq[],
+                                              TacsScalar dfdu[] ){
+  TACSElement *delem = selem->getDeterministicElement();
+  const int nsterms  = pc->getNumBasisTerms();
+  const int nsparams = pc->getNumParameters();
+  const int ndvpn    = delem->getVarsPerNode();
+  const int nsvpn    = selem->getVarsPerNode();
+  const int nddof    = delem->getNumVariables();
+  const int nnodes   = selem->getNumNodes();
+  memset(dfdu, 0, selem->getNumVariables()*sizeof(TacsScalar));
+
+  // Scratch arrays are taken from the workspace of this thread
+  TACSStochasticWorkspace::Frame work;
+  TacsScalar *zq = work.allocate(nsparams);
+  TacsScalar *yq = work.allocate(nsparams);
+  const TacsScalar *vecs[3] = {v, dv, ddv};
+
+  // Sensitivities of each basis term, one row per term
+  TacsScalar *gt = work.allocate(nsterms*nddof);
+
+  if (this->linear){
+    // dF/du_k = dF/df_k df/du, differentiated on the projected states
+    TacsScalar *uk = work.allocate(3*nsterms*nddof);
+    selem->getCoefficientStates(3, vecs, uk);
+    TacsScalar *dfdk = work.allocate(nsterms);
+    getCoefficientSens(pc, dfdq, dfdk);
+    memset(gt, 0, nsterms*nddof*sizeof(TacsScalar));
+    for (int k = 0; k < nsterms; k++){
+      const TacsScalar *u = &uk[3*k*nddof];
+      double pt[3] = {0.0, 0.0, 0.0};
+      int N = 1;
+      delem->addPointQuantitySVSens(elemIndex, this->quantityType,
+                                    time, alpha, beta, gamma,
+                                    N, pt,
+                                    Xpts, u, &u[nddof], &u[2*nddof],
+                                    &dfdk[k], &gt[k*nddof]);
+    }
+  } else {
+    // Deterministic states at every quadrature node in y
+    TacsScalar *uc = work.allocate(3*nsqpts*nddof);
+    selem->getDeterministicStates(0, nsqpts, 3, vecs, uc);
+
+    // Weighted point sensitivities, one row per quadrature point
+    TacsScalar *gq = work.allocate(nsqpts*nddof);
+    memset(gq, 0, nsqpts*nddof*sizeof(TacsScalar));
+
+    for (int q = 0; q < nsqpts; q++){
+      pc->quadrature(q, zq, yq);
+      TACSElement *qelem = selem->getParameterizedElement(q, delem, yq);
+
+      const TacsScalar *uq   = &uc[3*q*nddof];
+      const TacsScalar *udq  = &uq[nddof];
+      const TacsScalar *uddq = &uq[2*nddof];
+
+      double pt[3] = {0.0, 0.0, 0.0};
+      int N = 1;
+      TacsScalar _dfdq = dfdq[q];
+      qelem->addPointQuantitySVSens(elemIndex, this->quantityType,
+                                    time, alpha, beta, gamma,
+                                    N, pt,
+                                    Xpts, uq, udq, uddq, &_dfdq,
+                                    &gq[q*nddof]);
+    }
+
+    // Project on the basis terms: dfdu_k = sum_q psi_k(z_q) g_q
+    int ldq, ldk;
+    pc->getBasisTableStrides(&ldq, &ldk);
+    MatrixKernels::gemm(0, 0, nsterms, nddof, nsqpts,
+                        1.0, pc->getBasisRow(0), ldq, gq, nddof,
+                        0.0, gt, nddof);
+  }
+
+  // Nodewise placement into the stochastic array
+  for (int k = 0; k < nsterms; k++){
+    for (int n = 0; n < nnodes; n++){
+      int lptr = k*nddof + n*ndvpn;
+      int gptr = n*nsvpn + k*ndvpn;
+      for (int d = 0; d < ndvpn; d++){
+        dfdu[gptr+d] = gt[lptr+d];
+      }
+    }
+  }
+}
+
+/*
+  Add the derivative of a statistic w.r.t. the design variables of an
+  element from one sweep over the quadrature points, or over the basis
+  terms in linear mode
+
+  @param elemIndex the local element index
+  @param selem the stochastic element
+  @param time the simulation time
+  @param scale the scalar integration factor to apply
+  @param Xpts the element node locations
+  @param v the stochastic element states
+  @param dv the first time derivatives of the states
+  @param ddv the second time derivatives of the states
+  @param dfdq the derivative of the statistic w.r.t. each f_q
+  @param dvLen the length of the design array
+  @param dfdx the design variable derivative
+*/
+void TACSStochasticMoments::addElementDVSens( int elemIndex,
+                                              TACSStochasticElement *selem,
+                                              double time, TacsScalar scale,
+                                              const TacsScalar Xpts[],
+                                              const TacsScalar v[],
+                                              const TacsScalar dv[],
+                                              const TacsScalar ddv[],
+                                              const TacsScalar dfdq[],
+                                              int dvLen, TacsScalar dfdx[] ){
+  TACSElement *delem = selem->getDeterministicElement();
+  const int nsparams = pc->getNumParameters();
+  const int nddof    = delem->getNumVariables();
+
+  // Scratch arrays are taken from the workspace of this thread
+  TACSStochasticWorkspace::Frame work;
+  TacsScalar *zq = work.allocate(nsparams);
+  TacsScalar *yq = work.allocate(nsparams);
+
+  const TacsScalar *vecs[3] = {v, dv, ddv};
+
+  if (this->linear){
+    // F depends on x through f_0 = f(u_0) and f_k = f(u_k) - f(0)
+    TacsScalar *uk = work.allocate((3*nsterms + 3)*nddof);
+    selem->getCoefficientStates(3, vecs, uk);
+    TacsScalar *u0 = &uk[3*nsterms*nddof];
+    memset(u0, 0, 3*nddof*sizeof(TacsScalar));
+    TacsScalar *dfdk = work.allocate(nsterms+1);
+    getCoefficientSens(pc, dfdq, dfdk);
+    dfdk[nsterms] = 0.0;
+    for (int k = 1; k < nsterms; k++){
+      dfdk[nsterms] -= dfdk[k];
+    }
+    for (int k = 0; k <= nsterms; k++){
+      const TacsScalar *u = &uk[3*k*nddof];
+      double pt[3] = {0.0, 0.0, 0.0};
+      int N = 1;
+      delem->addPointQuantityDVSens(elemIndex, this->quantityType,
+                                    time, scale,
+                                    N, pt,
+                                    Xpts, u, &u[nddof], &u[2*nddof],
+                                    &dfdk[k], dvLen, dfdx);
+    }
+    return;
+  }
+
+  // Deterministic states at every quadrature node in y
+  TacsScalar *uc = work.allocate(3*nsqpts*nddof);
+  selem->getDeterministicStates(0, nsqpts, 3, vecs, uc);
+
+  for (int q = 0; q < nsqpts; q++){
+    pc->quadrature(q, zq, yq);
+    TACSElement *qelem = selem->getParameterizedElement(q, delem, yq);
+
+    const TacsScalar *uq   = &uc[3*q*nddof];
+    const TacsScalar *udq  = &uq[nddof];
+    const TacsScalar *uddq = &uq[2*nddof];
+
+    double pt[3] = {0.0, 0.0, 0.0};
+    int N = 1;
+    TacsScalar _dfdq = dfdq[q];
+    qelem->addPointQuantityDVSens(elemIndex, this->quantityType,
+                                  time, scale,
+                                  N, pt,
+                                  Xpts, uq, udq, uddq, &_dfdq,
+                                  dvLen, dfdx);
+  }
+}
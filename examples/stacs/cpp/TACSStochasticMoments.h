@@ -0,0 +1,120 @@
+/*
+  Shared evaluation of the statistical moments of a quantity of
+  interest for the stochastic function family
+*/
+
+#ifndef TACS_STOCHASTIC_MOMENTS_H
+#define TACS_STOCHASTIC_MOMENTS_H
+
+#include "TACSObject.h"
+#include "ParameterContainer.h"
+#include "TACSStochasticReduction.h"
+
+class TACSStochasticElement;
+
+/**
+   One-pass moment engine over the stochastic quadrature.
+
+   The states of each element are reconstructed at all quadrature
+   points in one product and the quantity f(y_q) is evaluated once per
+   point, giving the domain integrated values f_q. Every statistic is
+   computed from f_q: the raw moments E[f^m] = sum_q w_q f_q^m, the
+   projections f_k = sum_q w_q psi_k(z_q) f_q and the variance of the
+   projection sum_{k>0} f_k^2.
+
+   Sensitivities take the derivative dF/df_q of any combination F of
+   these statistics, so that the states and parameters are swept once
+   per element instead of once per moment and basis term.
+
+   Several function views (e.g. the mean and the second moment of the
+   same quantity) may share one engine: the first view to initialize
+   an evaluation accumulates the values and the others reuse them.
+
+   When the quantity is affine in the states and does not depend on
+   the parameters, its projections follow from the projected states
+   directly, f_0 = f(u_0) and f_k = f(u_k) - f(0). In this linear mode
+   each element is evaluated once per basis term instead of once per
+   quadrature point, and the mean, variance and covariance are closed
+   form in the coefficients. Other statistics reconstruct f_q from the
+   coefficients without further element calls.
+
+   @author Komahan Boopathy
+*/
+class TACSStochasticMoments : public TACSObject {
+ public:
+  TACSStochasticMoments( MPI_Comm comm, ParameterContainer *pc,
+                         int quantityType );
+  ~TACSStochasticMoments();
+
+  int getQuantityType();
+
+  // Overlap the reduction over the processors with the next function
+  void setNonblockingReduction( int flag );
+
+  // Take the moments from the projected coefficients of the quantity
+  void setLinearQuantity( int flag );
+
+  // Accumulation of the values at the quadrature points
+  //----------------------------------------------------
+  void initEvaluation( const void *view );
+  void addElement( const void *view,
+                   int elemIndex, TACSStochasticElement *selem,
+                   double time, TacsScalar scale,
+                   const TacsScalar Xpts[], const TacsScalar v[],
+                   const TacsScalar dv[], const TacsScalar ddv[] );
+  void finalEvaluation( const void *view );
+
+  // Statistics of the accumulated values
+  //-------------------------------------
+  const TacsScalar* getPointValues();
+  void getMoments( int nmoments, TacsScalar moments[] );
+  TacsScalar getMoment( int m );
+  TacsScalar getProjection( int k );
+  TacsScalar getVariance();
+  TacsScalar getCovariance( TACSStochasticMoments *other );
+
+  // Derivatives of the statistics w.r.t. the values at the points
+  //---------------------------------------------------------------
+  void getMomentSens( int nmoments, const TacsScalar coef[],
+                      TacsScalar dfdq[] );
+  void getVarianceSens( TacsScalar dfdq[] );
+
+  // Sensitivities of a statistic from one sweep over the points
+  //------------------------------------------------------------
+  void getElementSVSens( int elemIndex, TACSStochasticElement *selem,
+                         double time,
+                         TacsScalar alpha, TacsScalar beta, TacsScalar gamma,
+                         const TacsScalar Xpts[], const TacsScalar v[],
+                         const TacsScalar dv[], const TacsScalar ddv[],
+                         const TacsScalar dfdq[], TacsScalar dfdu[] );
+  void addElementDVSens( int elemIndex, TACSStochasticElement *selem,
+                         double time, TacsScalar scale,
+                         const TacsScalar Xpts[], const TacsScalar v[],
+                         const TacsScalar dv[], const TacsScalar ddv[],
+                         const TacsScalar dfdq[],
+                         int dvLen, TacsScalar dfdx[] );
+
+ private:
+  ParameterContainer *pc;
+  int quantityType;
+  int nsqpts;
+  int nsterms;
+
+  // Domain integrated quantity at each quadrature point
+  TacsScalar *fvals;
+
+  // Projections of the quantity in linear mode, from which the values
+  // at the points are reconstructed when needed
+  int linear;
+  int fvals_stale;
+  TacsScalar *fcoef;
+  void updatePointValues();
+
+  // The view accumulating the current evaluation (NULL when closed)
+  const void *owner;
+
+  // Reduction of the values, completed before they are read
+  TACSStochasticReduction *reduction;
+};
+
+#endif
@@ -0,0 +1,176 @@
+#include "TACSStochasticReduction.h"
+
+namespace{
+  /*
+    MPI reduction of log-sum-exp pairs, each pair is one element of a
+    contiguous type of two scalars
+  */
+  void mergeLogSumExpOp( void *in, void *inout, int *len, MPI_Datatype *type ){
+    const TacsScalar *a = static_cast<const TacsScalar*>(in);
+    TacsScalar *b = static_cast<TacsScalar*>(inout);
+    for ( int i = 0; i < *len; i++ ){
+      TACSStochasticReduction::mergeLogSumExp(&a[2*i], &b[2*i]);
+    }
+  }
+
+  // The pair type and the reduction, created on first use and freed
+  // with the last reduction object
+  MPI_Datatype pairType = MPI_DATATYPE_NULL;
+  MPI_Op pairOp = MPI_OP_NULL;
+  int numReductions = 0;
+
+  void createLogSumExpOp(){
+    if (pairOp == MPI_OP_NULL){
+      MPI_Type_contiguous(2, TACS_MPI_TYPE, &pairType);
+      MPI_Type_commit(&pairType);
+      MPI_Op_create(mergeLogSumExpOp, 1, &pairOp);
+    }
+  }
+
+  void freeLogSumExpOp(){
+    int finalized;
+    MPI_Finalized(&finalized);
+    if (pairOp != MPI_OP_NULL && !finalized){
+      MPI_Op_free(&pairOp);
+      MPI_Type_free(&pairType);
+    }
+    pairOp = MPI_OP_NULL;
+    pairType = MPI_DATATYPE_NULL;
+  }
+}
+
+/*
+  Constructor
+
+  @param comm the communicator of the assembler
+*/
+TACSStochasticReduction::TACSStochasticReduction( MPI_Comm comm ){
+  this->comm = comm;
+  this->nonblocking = 0;
+  this->pending = 0;
+  this->request = MPI_REQUEST_NULL;
+  numReductions++;
+}
+
+/*
+  Destructor: the buffer of a pending reduction may be freed next. The
+  last reduction object frees the log-sum-exp type and operation.
+*/
+TACSStochasticReduction::~TACSStochasticReduction(){
+  wait();
+  numReductions--;
+  if (numReductions == 0){
+    freeLogSumExpOp();
+  }
+}
+
+/*
+  Overlap the reductions with the following work (off by default)
+*/
+void TACSStochasticReduction::setNonblocking( int flag ){
+  wait();
+  this->nonblocking = flag;
+}
+
+/*
+  Reduce n values in place over all processors with a single
+  collective. In nonblocking mode the reduction is only started.
+
+  @param vals the values to reduce
+  @param n the number of values
+  @param op the reduction operation (e.g. MPI_SUM or TACS_MPI_MAX)
+*/
+void TACSStochasticReduction::allreduce( TacsScalar *vals, int n,
+                                         MPI_Op op ){
+  wait();
+  if (this->nonblocking){
+    MPI_Iallreduce(MPI_IN_PLACE, vals, n, TACS_MPI_TYPE, op,
+                   this->comm, &this->request);
+    this->pending = 1;
+  } else {
+    MPI_Allreduce(MPI_IN_PLACE, vals, n, TACS_MPI_TYPE, op, this->comm);
+  }
+}
+
+/*
+  Complete the pending reduction, if any
+
+  @return 1 if a reduction was completed, 0 otherwise
+*/
+int TACSStochasticReduction::wait(){
+  if (this->pending){
+    MPI_Wait(&this->request, MPI_STATUS_IGNORE);
+    this->pending = 0;
+    return 1;
+  }
+  return 0;
+}
+
+/*
+  Merge the log-sum-exp pairs over all processors with a single
+  collective. In nonblocking mode the reduction is only started.
+
+  @param pairs the (a, s) pairs to merge (2*npairs)
+  @param npairs the number of pairs
+*/
+void TACSStochasticReduction::allreduceLogSumExp( TacsScalar *pairs,
+                                                  int npairs ){
+  wait();
+  createLogSumExpOp();
+  if (this->nonblocking){
+    MPI_Iallreduce(MPI_IN_PLACE, pairs, npairs, pairType, pairOp,
+                   this->comm, &this->request);
+    this->pending = 1;
+  } else {
+    MPI_Allreduce(MPI_IN_PLACE, pairs, npairs, pairType, pairOp, this->comm);
+  }
+}
+
+/*
+  Set the pairs to the empty sum
+
+  @param pairs the (a, s) pairs (2*npairs)
+  @param npairs the number of pairs
+*/
+void TACSStochasticReduction::initLogSumExp( TacsScalar *pairs, int npairs ){
+  for ( int i = 0; i < npairs; i++ ){
+    pairs[2*i] = -1.0e20;
+    pairs[2*i+1] = 0.0;
+  }
+}
+
+/*
+  Add the term c*exp(a) to the pair (a0, s) representing s*exp(a0).
+  The sum is rescaled when a raises the maximum exponent, so that all
+  the exponentials stay bounded by one.
+
+  @param pair the (a0, s) pair
+  @param a the exponent of the term
+  @param c the (non-negative) coefficient of the term
+*/
+void TACSStochasticReduction::addLogSumExp( TacsScalar pair[],
+                                            TacsScalar a, TacsScalar c ){
+  if (TacsRealPart(a) > TacsRealPart(pair[0])){
+    pair[1] = pair[1]*exp(pair[0] - a) + c;
+    pair[0] = a;
+  } else {
+    pair[1] += c*exp(a - pair[0]);
+  }
+}
+
+/*
+  Merge the pair in into inout; the merge is associative and
+  commutative so partial sums may be combined in any order
+
+  @param in the pair to merge
+  @param inout the pair merged into
+*/
+void TACSStochasticReduction::mergeLogSumExp( const TacsScalar in[],
+                                              TacsScalar inout[] ){
+  if (TacsRealPart(in[0]) > TacsRealPart(inout[0])){
+    inout[1] = inout[1]*exp(inout[0] - in[0]) + in[1];
+    inout[0] = in[0];
+  } else {
+    inout[1] += in[1]*exp(in[0] - inout[0]);
+  }
+}
@@ -0,0 +1,53 @@
+/*
+  Reduction of the quadrature buffers of the stochastic functions over
+  the processors
+*/
+
+#ifndef TACS_STOCHASTIC_REDUCTION_H
+#define TACS_STOCHASTIC_REDUCTION_H
+
+#include "TACSObject.h"
+
+/**
+   Reduces a whole buffer of values at the stochastic quadrature points
+   (function values, KS sums or maxima) in one collective instead of one
+   collective per entry.
+
+   In nonblocking mode the reduction is started with MPI_Iallreduce and
+   completed by wait(), so that it overlaps with the evaluation of the
+   next function. The buffer must not be accessed before wait() returns;
+   starting another reduction waits for the previous one.
+
+   KS aggregates are accumulated in a single pass as log-sum-exp pairs
+   (a, s) representing s*exp(a), with a the largest exponent seen so
+   far. A new term rescales the sum when it raises the maximum, and two
+   partial pairs (from different threads or processors) are merged the
+   same way, so no separate pass for the maximum is needed.
+*/
+class TACSStochasticReduction {
+ public:
+  TACSStochasticReduction( MPI_Comm comm );
+  ~TACSStochasticReduction();
+
+  void setNonblocking( int flag );
+
+  // Reduce the values in place and complete a pending reduction
+  void allreduce( TacsScalar *vals, int n, MPI_Op op );
+  int wait();
+
+  // Merge log-sum-exp pairs over the processors in place
+  void allreduceLogSumExp( TacsScalar *pairs, int npairs );
+
+  // Single-pass log-sum-exp accumulation
+  static void initLogSumExp( TacsScalar *pairs, int npairs );
+  static void addLogSumExp( TacsScalar pair[], TacsScalar a, TacsScalar c );
+  static void mergeLogSumExp( const TacsScalar in[], TacsScalar inout[] );
+
+ private:
+  MPI_Comm comm;
+  int nonblocking;
+  int pending;
+  MPI_Request request;
+};
+
+#endif
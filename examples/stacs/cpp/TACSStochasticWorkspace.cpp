@@ -0,0 +1,151 @@
+#include <stdlib.h>
+#include "TACSStochasticWorkspace.h"
+
+namespace{
+  // Allocations are padded to keep every array 64-byte aligned
+  const size_t ALIGN = 64;
+  const size_t PAD = (ALIGN + sizeof(TacsScalar) - 1)/sizeof(TacsScalar);
+
+  size_t padded( size_t n ){
+    return PAD*((n + PAD - 1)/PAD);
+  }
+
+  TacsScalar* alignedAlloc( size_t n ){
+    void *ptr = NULL;
+    if (posix_memalign(&ptr, ALIGN, n*sizeof(TacsScalar)) != 0){
+      printf("Error: Unable to allocate stochastic workspace of size %zu\n", n);
+      return NULL;
+    }
+    return (TacsScalar*)ptr;
+  }
+}
+
+/*
+  Constructor
+*/
+TACSStochasticWorkspace::TACSStochasticWorkspace(){
+  this->block = 0;
+  this->offset = 0;
+  this->depth = 0;
+}
+
+/*
+  Destructor
+*/
+TACSStochasticWorkspace::~TACSStochasticWorkspace(){
+  for (size_t b = 0; b < blocks.size(); b++){
+    free(blocks[b]);
+  }
+}
+
+/*
+  Return the workspace of the calling thread
+*/
+TACSStochasticWorkspace* TACSStochasticWorkspace::getThreadWorkspace(){
+  static thread_local TACSStochasticWorkspace work;
+  return &work;
+}
+
+/*
+  Return the total storage held by the workspace
+*/
+size_t TACSStochasticWorkspace::getCapacity(){
+  size_t capacity = 0;
+  for (size_t b = 0; b < sizes.size(); b++){
+    capacity += sizes[b];
+  }
+  return capacity;
+}
+
+/*
+  Replace the blocks by a single block of at least the given size.
+  Only called when no frame is open.
+*/
+void TACSStochasticWorkspace::reserve( size_t size ){
+  size_t capacity = getCapacity();
+  if (blocks.size() == 1 && capacity >= size){
+    return;
+  }
+  if (size < capacity){
+    size = capacity;
+  }
+  for (size_t b = 0; b < blocks.size(); b++){
+    free(blocks[b]);
+  }
+  blocks.clear();
+  sizes.clear();
+  if (size > 0){
+    blocks.push_back(alignedAlloc(size));
+    sizes.push_back(size);
+  }
+  block = offset = 0;
+}
+
+/*
+  Take n entries from the current block, moving to the next block or
+  adding one when it does not fit
+*/
+TacsScalar* TACSStochasticWorkspace::allocate( size_t n ){
+  n = padded(n);
+  while (block < blocks.size() && offset + n > sizes[block]){
+    block++;
+    offset = 0;
+  }
+  if (block == blocks.size()){
+    size_t size = sizes.empty() ? n : sizes.back();
+    if (size < n){
+      size = n;
+    }
+    blocks.push_back(alignedAlloc(size));
+    sizes.push_back(size);
+  }
+  TacsScalar *ptr = &blocks[block][offset];
+  offset += n;
+  return ptr;
+}
+
+/*
+  Merge the blocks grown during the outermost frame
+*/
+void TACSStochasticWorkspace::release(){
+  if (blocks.size() > 1){
+    reserve(getCapacity());
+  }
+  block = offset = 0;
+}
+
+/**
+   Open a frame on the workspace of the calling thread
+
+   @param size the number of entries the frame expects to allocate
+*/
+TACSStochasticWorkspace::Frame::Frame( size_t size ){
+  work = TACSStochasticWorkspace::getThreadWorkspace();
+  if (work->depth == 0 && size > 0){
+    work->reserve(size);
+  }
+  work->depth++;
+  block = work->block;
+  offset = work->offset;
+}
+
+/**
+   Close the frame and return its arrays to the workspace
+*/
+TACSStochasticWorkspace::Frame::~Frame(){
+  work->block = block;
+  work->offset = offset;
+  work->depth--;
+  if (work->depth == 0){
+    work->release();
+  }
+}
+
+/**
+   Return an uninitialized 64-byte aligned array
+
+   @param n the number of entries
+*/
+TacsScalar* TACSStochasticWorkspace::Frame::allocate( size_t n ){
+  return work->allocate(n);
+}
@@ -0,0 +1,67 @@
+/*
+  A thread-local scratch arena for the stochastic element and function
+  kernels
+*/
+
+#ifndef TACS_STOCHASTIC_WORKSPACE_H
+#define TACS_STOCHASTIC_WORKSPACE_H
+
+#include <vector>
+#include "TACSObject.h"
+
+/**
+   Reusable workspace for the temporary arrays of the stochastic
+   kernels, which run per element, per Newton iteration and per time
+   step.
+
+   Each thread owns one arena of 64-byte aligned storage. A kernel
+   opens a Frame, carves its arrays out of the arena and the frame
+   releases them on exit, so no heap allocation takes place once the
+   arena has grown to the largest kernel. The arena is sized when the
+   first frame asks for its size and grows by adding blocks that are
+   merged into one when the outermost frame closes.
+
+   Arrays handed out by a frame are not initialized.
+*/
+class TACSStochasticWorkspace {
+ public:
+  /**
+     Scoped allocation from the workspace of the calling thread
+  */
+  class Frame {
+   public:
+    Frame( size_t size = 0 );
+    ~Frame();
+
+    TacsScalar* allocate( size_t n );
+
+   private:
+    TACSStochasticWorkspace *work;
+    size_t block, offset;
+  };
+
+  // Workspace of the calling thread
+  static TACSStochasticWorkspace* getThreadWorkspace();
+
+  // Total storage held by the workspace
+  size_t getCapacity();
+
+  ~TACSStochasticWorkspace();
+
+ private:
+  TACSStochasticWorkspace();
+
+  void reserve( size_t size );
+  TacsScalar* allocate( size_t n );
+  void release();
+
+  // Aligned blocks of storage and their sizes
+  std::vector<TacsScalar*> blocks;
+  std::vector<size_t> sizes;
+
+  // Current position and number of open frames
+  size_t block, offset;
+  int depth;
+};
+
+#endif
@@ -10,7 +10,7 @@ void updateSMD( TACSElement *elem, TacsScalar *vals ){
 }
 
 SMD::SMD(TacsScalar m, TacsScalar c, TacsScalar k,
-         TacsScalar u0, TacsScalar udot0){
+         TacsScalar u0, TacsScalar udot0) : TACSParameterizedElement(3){
   // coefficients
   this->m = m;
   this->c = c;
@@ -25,6 +25,19 @@ SMD::~SMD(){
   printf("Decrefing SMD deterministic element\n");
 }
 
+void SMD::setRandomParameters( const TacsScalar y[] ){
+  int pid;
+  if ((pid = getParameterMap(MASS)) >= 0){
+    this->m = y[pid];
+  }
+  if ((pid = getParameterMap(DAMPING)) >= 0){
+    this->c = y[pid];
+  }
+  if ((pid = getParameterMap(STIFFNESS)) >= 0){
+    this->k = y[pid];
+  }
+}
+
 void SMD::getInitConditions( int elemIndex, const TacsScalar X[],
                              TacsScalar v[], TacsScalar dv[], TacsScalar ddv[] ){
   int num_vars = getNumNodes()*getVarsPerNode();
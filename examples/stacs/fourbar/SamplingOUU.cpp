@@ -28,8 +28,8 @@ SamplingOUU::~SamplingOUU(){
 
 void SamplingOUU::evaluateFuncGrad( Index n, const Number* x ){
 
-  int nqpoints = 5;
-  int nqpts[1] = {nqpoints};
+  // Use the points of the rule chosen for the parameter (Gauss or nested)
+  const int nqpoints = pc->getNumQuadraturePoints();
 
   // Store mass, failure, mass deriv, failure deriv
   TacsScalar **data = new TacsScalar*[nqpoints];
@@ -10,6 +10,8 @@
 #include "TACSElementVerification.h"
 #include "ParameterContainer.h"
 #include "ParameterFactory.h"
+#include <map>
+#include <vector>
 
 /*
   Create and return the TACSAssembler object for the four bar
@@ -221,149 +223,199 @@ TACSAssembler *four_bar_mechanism( int nA, int nB, int nC, TacsScalar _theta ){
 }
 
 #ifndef OPT
+/*
+  Solve the forward and adjoint problems at the angle theta and store
+  mass, failure, mass deriv, failure deriv in data
+*/
+void four_bar_sample( TacsScalar theta, int num_steps, TacsScalar *data ){
+  // Create the finite-element model
+  int nA = 4, nB = 8, nC = 4;
+  TACSAssembler *assembler = four_bar_mechanism(nA, nB, nC, theta);
+  assembler->incref();
+
+  // Set the final time
+  double tf = 12.0;
+
+  // Create the integrator class
+  TACSIntegrator *integrator =
+    new TACSBDFIntegrator(assembler, 0.0, tf, num_steps, 2);
+  integrator->incref();
+
+  // Set the integrator options
+  integrator->setUseSchurMat(1, TACSAssembler::TACS_AMD_ORDER);
+  integrator->setAbsTol(1e-7);
+  integrator->setRelTol(1e-12);
+  integrator->setOutputFrequency(0);
+
+  // Integrate the equations of motion forward in time
+  integrator->integrate();
+
+  // Create the continuous KS function
+  double ksRho = 10000.0;
+  TACSKSFailure *ksfunc = new TACSKSFailure(assembler, ksRho);
+  TACSStructuralMass *fmass = new TACSStructuralMass(assembler);
+
+  // Set the functions
+  TACSFunction **funcs = new TACSFunction*[2]; //fmass
+  funcs[0] = fmass;
+  funcs[1] = ksfunc;
+  integrator->setFunctions(2, funcs);
+
+  TacsScalar fval[2];
+  integrator->evalFunctions(fval);
+  printf("Function value: %.17e %.17e \n", TacsRealPart(fval[0]), TacsRealPart(fval[1]));
+
+  // Evaluate the adjoint
+  integrator->integrateAdjoint();
+
+  // Get the gradient
+  TACSBVec *massdfdx;
+  TACSBVec *faildfdx;
+  integrator->getGradient(0, &massdfdx);
+  integrator->getGradient(1, &faildfdx);
+
+  TacsScalar *massdfdxvals, *faildfdxvals;
+  massdfdx->getArray(&massdfdxvals);
+  faildfdx->getArray(&faildfdxvals);
+
+  data[0] = fval[0];
+  data[1] = fval[1];
+
+  data[2] = massdfdxvals[0];
+  data[3] = faildfdxvals[0];
+
+  integrator->decref();
+  assembler->decref();
+}
+
 int main( int argc, char *argv[] ){
   // Initialize MPI
   MPI_Init(&argc, &argv);
 
   // The number of total steps (100 per second)
-  const int num_steps = 1200;  
-  int pnqpts[1] = {20};
+  const int num_steps = 1200;
   ParameterFactory *factory = new ParameterFactory();
   AbstractParameter *ptheta = factory->createNormalParameter(5.0, 2.5, 0);
 
+  // Nested Genz-Keister points are kept when the rule is refined
+  ptheta->setQuadratureRule(AbstractParameter::GENZ_KEISTER);
+
   ParameterContainer *pc = new ParameterContainer();
   pc->addParameter(ptheta);
-  pc->initializeQuadrature(pnqpts);
 
-  const int nqpoints = pc->getNumQuadraturePoints();
   const int nvars = pc->getNumParameters();
-
-  // Store mass, failure, mass deriv, failure deriv
-  TacsScalar **data = new TacsScalar*[nqpoints];
-  for (int i = 0; i < nqpoints; i++){
-    data[i] = new TacsScalar[4];
-  }
-
   TacsScalar *zq = new TacsScalar[nvars];
   TacsScalar *yq = new TacsScalar[nvars];
   TacsScalar wq;
 
-  for (int iq = 0; iq < nqpoints; iq++){
-
-    wq = pc->quadrature(iq, zq, yq);
-
-    // Create the finite-element model
-    int nA = 4, nB = 8, nC = 4;
-    TACSAssembler *assembler = four_bar_mechanism(nA, nB, nC, yq[0]);
-    assembler->incref();
-
-    // Set the final time
-    double tf = 12.0;
-
-    // Create the integrator class
-    TACSIntegrator *integrator =
-      new TACSBDFIntegrator(assembler, 0.0, tf, num_steps, 2);
-    integrator->incref();
-
-    // Set the integrator options
-    integrator->setUseSchurMat(1, TACSAssembler::TACS_AMD_ORDER);
-    integrator->setAbsTol(1e-7);
-    integrator->setRelTol(1e-12);
-    integrator->setOutputFrequency(0);
-
-    // Integrate the equations of motion forward in time
-    integrator->integrate();
-
-    // Create the continuous KS function
-    double ksRho = 10000.0;
-    TACSKSFailure *ksfunc = new TACSKSFailure(assembler, ksRho);
-    TACSStructuralMass *fmass = new TACSStructuralMass(assembler);
-
-    // Set the functions
-    TACSFunction **funcs = new TACSFunction*[2]; //fmass
-    funcs[0] = fmass;
-    funcs[1] = ksfunc;
-    integrator->setFunctions(2, funcs);
-
-    TacsScalar fval[2];
-    integrator->evalFunctions(fval);
-    printf("Function value: %.17e %.17e \n", TacsRealPart(fval[0]), TacsRealPart(fval[1]));
-
-    // Evaluate the adjoint
-    integrator->integrateAdjoint();
-
-    // Get the gradient
-    TACSBVec *massdfdx;
-    TACSBVec *faildfdx;
-    integrator->getGradient(0, &massdfdx);
-    integrator->getGradient(1, &faildfdx);
-
-    TacsScalar *massdfdxvals, *faildfdxvals;
-    massdfdx->getArray(&massdfdxvals);
-    faildfdx->getArray(&faildfdxvals);
-
-    data[iq][0] = fval[0];
-    data[iq][1] = fval[1];
-
-    data[iq][2] = massdfdxvals[0];
-    data[iq][3] = faildfdxvals[0];
-    
-    integrator->decref();
-    assembler->decref();
-
-  } // end quadrature
-
-  TacsScalar failmean, fail2mean, failvar;
-  TacsScalar massmean, mass2mean, massvar;
-
-  TacsScalar massmeanderiv, massderivtmp, massvarderiv;
-  TacsScalar failmeanderiv, failderivtmp, failvarderiv;
-
-  // Compute mean and variance of mid point of beam 1
-  for (int q = 0; q < nqpoints; q++){
-
-    wq = pc->quadrature(q, zq, yq);
-
-    // mass 
-    massmean += wq*data[q][0]; // E[F]
-    mass2mean += wq*data[q][0]*data[q][0]; // E{F*F}
-
-    // failure
-    failmean += wq*data[q][1]; // E[F]
-    fail2mean += wq*data[q][1]*data[q][1]; // E{F*F}
-
-    // massmean deriv
-    massmeanderiv += wq*data[q][2]; // E[F]
-    massderivtmp  += wq*2.0*data[q][0]*data[q][2]; // E{F*F}
+  // Store mass, failure, mass deriv, failure deriv at each point
+  // solved so far, keyed by the point in the standard domain
+  std::map<std::vector<double>, TacsScalar*> samples;
+
+  // Refine the rule (3, 9, 19 and 35 points) until the moments settle
+  const int nrefine = 4;
+  int pnqpts[nrefine] = {2, 5, 10, 20};
+  const double tol = 1.0e-6;
+  TacsScalar failmean = 0.0, failmeanprev = 0.0;
+
+  for (int r = 0; r < nrefine; r++){
+    pc->initializeQuadrature(&pnqpts[r]);
+    const int nqpoints = pc->getNumQuadraturePoints();
+
+    TacsScalar **data = new TacsScalar*[nqpoints];
+    int nsolves = 0;
+    for (int iq = 0; iq < nqpoints; iq++){
+      wq = pc->quadrature(iq, zq, yq);
+
+      std::vector<double> key(nvars);
+      for (int i = 0; i < nvars; i++){
+        key[i] = TacsRealPart(zq[i]);
+      }
+      std::map<std::vector<double>, TacsScalar*>::iterator it = samples.find(key);
+      if (it == samples.end()){
+        data[iq] = new TacsScalar[4];
+        four_bar_sample(yq[0], num_steps, data[iq]);
+        samples[key] = data[iq];
+        nsolves++;
+      } else {
+        data[iq] = it->second;
+      }
+    } // end quadrature
+
+    TacsScalar fail2mean, failvar;
+    TacsScalar massmean, mass2mean, massvar;
+
+    TacsScalar massmeanderiv, massderivtmp, massvarderiv;
+    TacsScalar failmeanderiv, failderivtmp, failvarderiv;
+
+    failmean = fail2mean = 0.0;
+    massmean = mass2mean = 0.0;
+    massmeanderiv = massderivtmp = 0.0;
+    failmeanderiv = failderivtmp = 0.0;
+
+    // Compute mean and variance of mid point of beam 1
+    for (int q = 0; q < nqpoints; q++){
+
+      wq = pc->quadrature(q, zq, yq);
+
+      // mass
+      massmean += wq*data[q][0]; // E[F]
+      mass2mean += wq*data[q][0]*data[q][0]; // E{F*F}
+
+      // failure
+      failmean += wq*data[q][1]; // E[F]
+      fail2mean += wq*data[q][1]*data[q][1]; // E{F*F}
+
+      // massmean deriv
+      massmeanderiv += wq*data[q][2]; // E[F]
+      massderivtmp  += wq*2.0*data[q][0]*data[q][2]; // E{F*F}
+
+      failmeanderiv += wq*data[q][3]; // E[F]
+      failderivtmp  += wq*2.0*data[q][1]*data[q][3]; // E{F*F}
+
+    }
+    delete [] data;
+
+    // Compute mean and variance
+    massvar = mass2mean - massmean*massmean;
+    failvar = fail2mean - failmean*failmean;
+    massvarderiv = massderivtmp - 2.0*massmean*massmeanderiv;
+    failvarderiv = failderivtmp - 2.0*failmean*failmeanderiv;
+
+    printf("points %d new solves %d\n", nqpoints, nsolves);
+
+    printf("%.17e %.17e %.17e %.17e %.17e %.17e \n",
+           TacsRealPart(massmean),
+           TacsRealPart(massmeanderiv),
+           TacsImagPart(massmean)/1.0e-30,
+           TacsRealPart(massvar),
+           TacsRealPart(massvarderiv),
+           TacsImagPart(massvar)/1.0e-30
+           );
+
+    printf("%.17e %.17e %.17e %.17e %.17e %.17e \n",
+           TacsRealPart(failmean),
+           TacsRealPart(failmeanderiv),
+           TacsImagPart(failmean)/1.0e-30,
+           TacsRealPart(failvar),
+           TacsRealPart(failvarderiv),
+           TacsImagPart(failvar)/1.0e-30
+           );
+
+    // Stop once the refinement no longer changes the mean failure
+    if (r > 0 && fabs(TacsRealPart(failmean - failmeanprev)) <
+        tol*fabs(TacsRealPart(failmean))){
+      break;
+    }
+    failmeanprev = failmean;
+  }
 
-    failmeanderiv += wq*data[q][3]; // E[F]
-    failderivtmp  += wq*2.0*data[q][1]*data[q][3]; // E{F*F}
-  
+  std::map<std::vector<double>, TacsScalar*>::iterator it;
+  for (it = samples.begin(); it != samples.end(); it++){
+    delete [] it->second;
   }
-  
-  // Compute mean and variance
-  massvar = mass2mean - massmean*massmean;
-  failvar = fail2mean - failmean*failmean;
-  massvarderiv = massderivtmp - 2.0*massmean*massmeanderiv;
-  failvarderiv = failderivtmp - 2.0*failmean*failmeanderiv;
-
-  printf("%.17e %.17e %.17e %.17e %.17e %.17e \n",       
-         TacsRealPart(massmean), 
-         TacsRealPart(massmeanderiv),
-         TacsImagPart(massmean)/1.0e-30,
-         TacsRealPart(massvar),
-         TacsRealPart(massvarderiv),
-         TacsImagPart(massvar)/1.0e-30
-         );
-
-  printf("%.17e %.17e %.17e %.17e %.17e %.17e \n",       
-         TacsRealPart(failmean), 
-         TacsRealPart(failmeanderiv),
-         TacsImagPart(failmean)/1.0e-30,
-         TacsRealPart(failvar),
-         TacsRealPart(failvarderiv),
-         TacsImagPart(failvar)/1.0e-30
-         );
+  delete [] zq;
+  delete [] yq;
 
   MPI_Finalize();
   return 0;
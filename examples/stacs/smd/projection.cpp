@@ -21,16 +21,6 @@
 #include "TACSStochasticFMeanFunction.h"
 #include "TACSStochasticFFMeanFunction.h"
 
-void updateElement( TACSElement *elem, TacsScalar *vals ){
-  SMD *smd = dynamic_cast<SMD*>(elem);
-  if (smd != NULL) {
-    smd->c = vals[0];
-    // printf("smd parameters are %.17e %.17e %.17e \n", smd->m, smd->c, smd->k);
-  } else {
-    printf("Element mismatch while updating...");
-  }
-}
-
 int main( int argc, char *argv[] ){
 
   MPI_Init(&argc, &argv);
@@ -53,8 +43,11 @@ int main( int argc, char *argv[] ){
   TacsScalar mass = 2.5 + 1.0e-30j;
   TacsScalar damping = 0.2;
   TacsScalar stiffness = 5.0;
-  TACSElement *smd = new SMD(mass, damping, stiffness); 
-  TACSStochasticElement *ssmd = new TACSStochasticElement(smd, pc, updateElement);
+  SMD *smd = new SMD(mass, damping, stiffness); 
+
+  // The damping is drawn from the random parameter c
+  smd->setParameterMap(SMD::DAMPING, c->getParameterID());
+  TACSStochasticElement *ssmd = new TACSStochasticElement(smd, pc, NULL);
 
   // Assembler information to create TACS  
   int nelems = 1;
@@ -122,11 +115,17 @@ int main( int argc, char *argv[] ){
   if (!ks){
 
     // Stochastic Integral
-    spe = new TACSStochasticFMeanFunction(tacs, pe, pc, TACS_POTENTIAL_ENERGY_FUNCTION, FUNCTION_MEAN);
-    sdisp = new TACSStochasticFMeanFunction(tacs, disp, pc, TACS_DISPLACEMENT_FUNCTION, FUNCTION_MEAN);
-
-    spe2 = new TACSStochasticFFMeanFunction(tacs, pe, pc, TACS_POTENTIAL_ENERGY_FUNCTION, FUNCTION_VARIANCE);
-    sdisp2 = new TACSStochasticFFMeanFunction(tacs, disp, pc, TACS_DISPLACEMENT_FUNCTION, FUNCTION_VARIANCE);
+    TACSStochasticFMeanFunction *spemean, *sdispmean;
+    spemean = new TACSStochasticFMeanFunction(tacs, pe, pc, TACS_POTENTIAL_ENERGY_FUNCTION, FUNCTION_MEAN);
+    sdispmean = new TACSStochasticFMeanFunction(tacs, disp, pc, TACS_DISPLACEMENT_FUNCTION, FUNCTION_MEAN);
+    spe = spemean;
+    sdisp = sdispmean;
+
+    // The second moments reuse the quadrature values of the means
+    spe2 = new TACSStochasticFFMeanFunction(tacs, pe, pc, TACS_POTENTIAL_ENERGY_FUNCTION, FUNCTION_VARIANCE,
+                                            spemean->getMoments());
+    sdisp2 = new TACSStochasticFFMeanFunction(tacs, disp, pc, TACS_DISPLACEMENT_FUNCTION, FUNCTION_VARIANCE,
+                                              sdispmean->getMoments());
 
   } else {
     
@@ -30,12 +30,25 @@ void updateSMD( TACSElement *elem, TacsScalar *vals ){
   }
 }
 
-SMD::SMD(TacsScalar m, TacsScalar c, TacsScalar k){
+SMD::SMD(TacsScalar m, TacsScalar c, TacsScalar k) : TACSParameterizedElement(3){
   this->m = m;
   this->c = c;
   this->k = k;  
 }
 
+void SMD::setRandomParameters( const TacsScalar y[] ){
+  int pid;
+  if ((pid = getParameterMap(MASS)) >= 0){
+    this->m = y[pid];
+  }
+  if ((pid = getParameterMap(DAMPING)) >= 0){
+    this->c = y[pid];
+  }
+  if ((pid = getParameterMap(STIFFNESS)) >= 0){
+    this->k = y[pid];
+  }
+}
+
 void SMD::getInitConditions( int elemIndex, const TacsScalar X[],
                              TacsScalar v[], TacsScalar dv[], TacsScalar ddv[] ){
   int num_vars = getNumNodes()*getVarsPerNode();
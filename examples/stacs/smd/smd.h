@@ -1,4 +1,5 @@
 #include "TACSElement.h"
+#include "TACSParameterizedElement.h"
 
 // Define some quantities of interest
 static const int TACS_KINETIC_ENERGY_FUNCTION   = -1;
@@ -6,8 +7,11 @@ static const int TACS_POTENTIAL_ENERGY_FUNCTION = -2;
 static const int TACS_DISPLACEMENT_FUNCTION     = -3;
 static const int TACS_VELOCITY_FUNCTION         = -4;
 
-class SMD : public TACSElement{  
+class SMD : public TACSElement, public TACSParameterizedElement {
  public:
+  // Fields that may be random
+  enum RandomField { MASS = 0, DAMPING = 1, STIFFNESS = 2 };
+
   SMD(TacsScalar m, TacsScalar c, TacsScalar k);
 
   /**
@@ -192,5 +196,17 @@ class SMD : public TACSElement{
     return 1;
   }
 
+  /**
+     Set the random mass, damping and stiffness
+  */
+  void setRandomParameters( const TacsScalar y[] );
+
+  /**
+     The jacobian is linear in the mass, damping and stiffness
+  */
+  int getFieldDegree( int field ){
+    return 1;
+  }
+
   TacsScalar m, c, k;
 };
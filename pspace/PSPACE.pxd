@@ -5,6 +5,8 @@ cdef extern from "AbstractParameter.h":
     cdef cppclass AbstractParameter:
         #void quadrature(int npoints, scalar *z, scalar *y, scalar *w)
         scalar basis(scalar z, int d)
+        int getQuadratureRule()
+        void setQuadratureRule(int rule)
 
 cdef class PyAbstractParameter:
     cdef AbstractParameter *ptr
@@ -36,6 +38,11 @@ cdef extern from "ParameterContainer.h":
         void getBasisParamDeg(int k, int *degs)
         void getBasisParamMaxDeg(int *pmax)
 
+        # Moments from the projections on the basis terms
+        scalar getMean(const scalar *c, int inc)
+        scalar getVariance(const scalar *c, int inc)
+        scalar getCovariance(const scalar *a, const scalar *b, int inc)
+
         # Initiliazation tasks
         void initialize();
         void initializeBasis(const int *pmax)
@@ -43,3 +50,40 @@ cdef extern from "ParameterContainer.h":
 
 cdef class PyParameterContainer:
     cdef ParameterContainer *ptr
+
+cdef extern from "NestedQuadrature.h":
+    cdef cppclass NestedQuadrature:
+        @staticmethod
+        int getNumPoints(int rule, int level)
+        @staticmethod
+        int getDegree(int rule, int level)
+        @staticmethod
+        int getMaxLevel(int rule)
+        @staticmethod
+        void getRule(int rule, int level, const double **z, const double **w)
+
+cdef extern from "TensorProjector.h":
+    cdef cppclass TensorProjector:
+        TensorProjector(ParameterContainer *pc)
+        void project(int ndata, const scalar *fq, scalar *fk)
+        void reconstruct(int ndata, const scalar *fk, scalar *fq)
+
+cdef class PyTensorProjector:
+    cdef TensorProjector *ptr
+    cdef object pc
+
+cdef extern from "AdaptiveQuadrature.h":
+    cdef cppclass AdaptiveQuadrature:
+        AdaptiveQuadrature(ParameterContainer *pc, int nfuncs)
+        int integrate(void (*func)(void *ctx, const scalar *zq,
+                                   const scalar *yq, scalar *fq) noexcept,
+                      void *ctx, double tol, int max_evals, scalar *fmean,
+                      double atol)
+        double getErrorEstimate()
+        int getNumEvaluations()
+
+cdef class PyAdaptiveQuadrature:
+    cdef AdaptiveQuadrature *ptr
+    cdef object pc
+    cdef int nparams
+    cdef int nfuncs
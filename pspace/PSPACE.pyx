@@ -28,6 +28,11 @@ cdef class PyAbstractParameter:
         return
     def basis(self, scalar z, int d):
         return self.ptr.basis(z,d)
+    def getQuadratureRule(self):
+        return self.ptr.getQuadratureRule()
+    def setQuadratureRule(self, int rule):
+        self.ptr.setQuadratureRule(rule)
+        return
 
 cdef class PyParameterFactory:
     def __cinit__(self):
@@ -86,6 +91,24 @@ cdef class PyParameterContainer:
         self.ptr.getBasisParamMaxDeg(<int*> pmax.data)
         return pmax
 
+    def getMean(self, np.ndarray[scalar, ndim=1, mode='c'] c):
+        self.checkCoefficients(c)
+        return self.ptr.getMean(<scalar*> c.data, 1)
+    def getVariance(self, np.ndarray[scalar, ndim=1, mode='c'] c):
+        self.checkCoefficients(c)
+        return self.ptr.getVariance(<scalar*> c.data, 1)
+    def getCovariance(self,
+                      np.ndarray[scalar, ndim=1, mode='c'] a,
+                      np.ndarray[scalar, ndim=1, mode='c'] b):
+        self.checkCoefficients(a)
+        self.checkCoefficients(b)
+        return self.ptr.getCovariance(<scalar*> a.data, <scalar*> b.data, 1)
+    def checkCoefficients(self, np.ndarray[scalar, ndim=1, mode='c'] c):
+        nterms = self.ptr.getNumBasisTerms()
+        if c.shape[0] < nterms:
+            raise ValueError("Expected %d coefficients, got %d" % (nterms, c.shape[0]))
+        return
+
     def initialize(self):
         self.ptr.initialize()
         return
@@ -95,3 +118,79 @@ cdef class PyParameterContainer:
     def initializeQuadrature(self, np.ndarray[int, ndim=1, mode='c'] nqpts):
         self.ptr.initializeQuadrature(<int*> nqpts.data)
         return
+
+cdef class PyNestedQuadrature:
+    @staticmethod
+    def getNumPoints(int rule, int level):
+        return NestedQuadrature.getNumPoints(rule, level)
+    @staticmethod
+    def getDegree(int rule, int level):
+        return NestedQuadrature.getDegree(rule, level)
+    @staticmethod
+    def getMaxLevel(int rule):
+        return NestedQuadrature.getMaxLevel(rule)
+    @staticmethod
+    def getRule(int rule, int level):
+        cdef const double *z = NULL
+        cdef const double *w = NULL
+        NestedQuadrature.getRule(rule, level, &z, &w)
+        npts = NestedQuadrature.getNumPoints(rule, level)
+        zr = np.zeros(npts)
+        wr = np.zeros(npts)
+        for i in range(npts):
+            zr[i] = z[i]
+            wr[i] = w[i]
+        return zr, wr
+
+cdef class PyTensorProjector:
+    def __cinit__(self, PyParameterContainer pc):
+        self.pc = pc
+        self.ptr = new TensorProjector(pc.ptr)
+        return
+    def __dealloc__(self):
+        del self.ptr
+    def project(self, np.ndarray[scalar, ndim=1, mode='c'] fq):
+        cdef np.ndarray fk = None
+        fk = np.zeros(self.pc.getNumBasisTerms(), dtype=dtype)
+        self.ptr.project(1, <scalar*> fq.data, <scalar*> fk.data)
+        return fk
+    def reconstruct(self, np.ndarray[scalar, ndim=1, mode='c'] fk):
+        cdef np.ndarray fq = None
+        fq = np.zeros(self.pc.getNumQuadraturePoints(), dtype=dtype)
+        self.ptr.reconstruct(1, <scalar*> fk.data, <scalar*> fq.data)
+        return fq
+
+cdef void adaptiveQuantity(void *ctx, const scalar *zq,
+                           const scalar *yq, scalar *fq) noexcept with gil:
+    cdef PyAdaptiveQuadrature quad = (<tuple> ctx)[0]
+    func = (<tuple> ctx)[1]
+    z = np.zeros(quad.nparams, dtype=dtype)
+    y = np.zeros(quad.nparams, dtype=dtype)
+    for i in range(quad.nparams):
+        z[i] = zq[i]
+        y[i] = yq[i]
+    f = np.atleast_1d(func(z, y))
+    for i in range(quad.nfuncs):
+        fq[i] = f[i]
+    return
+
+cdef class PyAdaptiveQuadrature:
+    def __cinit__(self, PyParameterContainer pc, int nfuncs=1):
+        self.pc = pc
+        self.nparams = pc.getNumParameters()
+        self.nfuncs = nfuncs
+        self.ptr = new AdaptiveQuadrature(pc.ptr, nfuncs)
+        return
+    def __dealloc__(self):
+        del self.ptr
+    def integrate(self, func, double tol, int max_evals, double atol=1.0e-14):
+        cdef np.ndarray fmean = None
+        fmean = np.zeros(self.nfuncs, dtype=dtype)
+        ctx = (self, func)
+        self.ptr.integrate(adaptiveQuantity, <void*> ctx, tol, max_evals,
+                           <scalar*> fmean.data, atol)
+        return fmean
+    def getErrorEstimate(self):
+        return self.ptr.getErrorEstimate()
+    def getNumEvaluations(self):
+        return self.ptr.getNumEvaluations()
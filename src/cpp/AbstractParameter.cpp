@@ -5,7 +5,9 @@
 */
 AbstractParameter::AbstractParameter(){
   this->gauss = new GaussianQuadrature();
+  this->nested = new NestedQuadrature();
   this->polyn = new OrthogonalPolynomials();
+  this->quadrature_rule = GAUSS;
 }
 
 /**
@@ -13,6 +15,7 @@ AbstractParameter::AbstractParameter(){
 */
 AbstractParameter::~AbstractParameter(){
   if(gauss){delete gauss;};
+  if(nested){delete nested;};
   if(polyn){delete polyn;};
 }
 
@@ -46,3 +49,84 @@ void AbstractParameter::setMaxDegree(int dmax){
 int AbstractParameter::getMaxDegree(){
   return this->dmax;
 }
+
+/**
+   Sets the univariate quadrature rule of the parameter. Nested rules
+   reuse the points of coarser rules when the quadrature is refined.
+   Rules not available for the distribution fall back to Gauss.
+
+   @param rule the quadrature rule
+*/
+void AbstractParameter::setQuadratureRule(int rule){
+  if (!hasQuadratureRule(rule)){
+    printf("Warning: Quadrature rule %d is not available for parameter %d, "
+           "using Gauss quadrature\n", rule, this->parameter_id);
+    rule = GAUSS;
+  }
+  this->quadrature_rule = rule;
+}
+
+/**
+   Returns the univariate quadrature rule of the parameter
+*/
+int AbstractParameter::getQuadratureRule(){
+  return this->quadrature_rule;
+}
+
+/**
+   Returns the number of quadrature points at a level of refinement
+   (1, 2, ...). Gauss rules add one point per level while nested rules
+   grow as their families prescribe. Returns zero beyond the finest
+   level of the rule.
+
+   @param level the level of refinement
+*/
+int AbstractParameter::getQuadratureSize(int level){
+  if (this->quadrature_rule == GAUSS){
+    return level;
+  }
+  return NestedQuadrature::getNumPoints(this->quadrature_rule, level);
+}
+
+/**
+   Returns the polynomial degree integrated exactly by the rule at a
+   level of refinement
+
+   @param level the level of refinement
+*/
+int AbstractParameter::getQuadratureDegree(int level){
+  if (this->quadrature_rule == GAUSS){
+    return 2*level - 1;
+  }
+  return NestedQuadrature::getDegree(this->quadrature_rule, level);
+}
+
+/**
+   Returns the coarsest level whose rule is as accurate as the Gauss
+   rule with npoints, i.e. integrates polynomials of degree 2*npoints-1
+   exactly, or the finest level of a nested rule that is less accurate
+
+   @param npoints the number of Gauss quadrature points
+*/
+int AbstractParameter::getQuadratureLevel(int npoints){
+  if (this->quadrature_rule == GAUSS){
+    return npoints;
+  }
+  const int lmax = NestedQuadrature::getMaxLevel(this->quadrature_rule);
+  for (int level = 1; level < lmax; level++){
+    if (getQuadratureDegree(level) >= 2*npoints - 1){
+      return level;
+    }
+  }
+  return lmax;
+}
+
+/**
+   Returns whether the quadrature rule is available for the
+   distribution. Gauss quadrature is always available.
+
+   @param rule the quadrature rule
+*/
+bool AbstractParameter::hasQuadratureRule(int rule){
+  return rule == GAUSS;
+}
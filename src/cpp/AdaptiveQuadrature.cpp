@@ -0,0 +1,332 @@
+#include <stdio.h>
+#include <math.h>
+#include <set>
+
+#include "AdaptiveQuadrature.h"
+
+/**
+   Constructor for the adaptive quadrature
+
+   @param pc the parameter container holding the parameters
+   @param nfuncs the number of quantities of interest
+*/
+AdaptiveQuadrature::AdaptiveQuadrature( ParameterContainer *_pc,
+                                        int _nfuncs ){
+  this->pc = _pc;
+  this->nvars = pc->getNumParameters();
+  this->nfuncs = _nfuncs;
+  this->error_estimate = 0.0;
+  this->zrule.resize(nvars);
+  this->yrule.resize(nvars);
+  this->wrule.resize(nvars);
+}
+
+/**
+   Destructor
+*/
+AdaptiveQuadrature::~AdaptiveQuadrature(){}
+
+/**
+   Returns the univariate rule of a parameter at a level, generating
+   it on first access
+
+   @param i the parameter
+   @param level the level of the rule
+   @param npts returns the number of points
+   @param z returns the points in standard domain
+   @param y returns the points in general domain
+   @param w returns the weights
+*/
+void AdaptiveQuadrature::getRule( int i, int level, int *npts,
+                                  const scalar **z, const scalar **y,
+                                  const scalar **w ){
+  AbstractParameter *param = pc->getParameter(i);
+  while ((int)zrule[i].size() < level){
+    int n = param->getQuadratureSize(zrule[i].size() + 1);
+    std::vector<scalar> zr(n), yr(n), wr(n);
+    param->quadrature(n, zr.data(), yr.data(), wr.data());
+    zrule[i].push_back(zr);
+    yrule[i].push_back(yr);
+    wrule[i].push_back(wr);
+  }
+  *npts = zrule[i][level-1].size();
+  *z = zrule[i][level-1].data();
+  *y = yrule[i][level-1].data();
+  *w = wrule[i][level-1].data();
+}
+
+/**
+   Computes the hierarchical surplus of the quantities of interest at
+   a level index, the tensor product of the differences of successive
+   univariate rules
+
+     delta = sum_e (-1)^|e| Q_{index - e} f
+
+   over the binary offsets e that keep every level positive. The
+   quantities of interest are evaluated at the points not cached yet.
+
+   @param index the level index
+   @param func the quantities of interest
+   @param ctx the context passed to func
+   @param max_evals the budget of evaluations
+   @param delta returns the surplus of each quantity
+   @return 1 when the budget does not allow the new points, 0 otherwise
+*/
+int AdaptiveQuadrature::computeSurplus( const std::vector<int> &index,
+                                        QuantityOfInterest func, void *ctx,
+                                        int max_evals, scalar *delta ){
+  // Directions that have a coarser rule to subtract
+  std::vector<int> dirs;
+  for (int i = 0; i < nvars; i++){
+    if (index[i] > 1){
+      dirs.push_back(i);
+    }
+  }
+  const int ndirs = dirs.size();
+
+  std::vector<int> npts(nvars), idx(nvars), level(nvars);
+  std::vector<const scalar*> z(nvars), y(nvars), w(nvars);
+  std::vector<double> key(nvars);
+
+  for (int pass = 0; pass < 2; pass++){
+    // First pass collects the new points, second pass integrates
+    std::set< std::vector<double> > missing;
+    for (int k = 0; k < nfuncs; k++){
+      delta[k] = 0.0;
+    }
+
+    for (int e = 0; e < (1 << ndirs); e++){
+      int sign = 1;
+      level = index;
+      for (int j = 0; j < ndirs; j++){
+        if (e & (1 << j)){
+          level[dirs[j]]--;
+          sign = -sign;
+        }
+      }
+
+      int ntensor = 1;
+      for (int i = 0; i < nvars; i++){
+        getRule(i, level[i], &npts[i], &z[i], &y[i], &w[i]);
+        ntensor *= npts[i];
+        idx[i] = 0;
+      }
+
+      for (int ctr = 0; ctr < ntensor; ctr++){
+        for (int i = 0; i < nvars; i++){
+          key[i] = RealPart(z[i][idx[i]]);
+        }
+        std::map<std::vector<double>, std::vector<scalar> >::iterator it;
+        it = fcache.find(key);
+        if (pass == 0){
+          if (it == fcache.end()){
+            missing.insert(key);
+          }
+        } else {
+          if (it == fcache.end()){
+            scalar *zq = new scalar[nvars];
+            scalar *yq = new scalar[nvars];
+            for (int i = 0; i < nvars; i++){
+              zq[i] = z[i][idx[i]];
+              yq[i] = y[i][idx[i]];
+            }
+            std::vector<scalar> fq(nfuncs);
+            func(ctx, zq, yq, fq.data());
+            it = fcache.insert(std::make_pair(key, fq)).first;
+            delete [] zq;
+            delete [] yq;
+          }
+          scalar wq = double(sign);
+          for (int i = 0; i < nvars; i++){
+            wq *= w[i][idx[i]];
+          }
+          for (int k = 0; k < nfuncs; k++){
+            delta[k] += wq*it->second[k];
+          }
+        }
+
+        for (int i = nvars-1; i >= 0; i--){
+          if (++idx[i] < npts[i]){
+            break;
+          }
+          idx[i] = 0;
+        }
+      }
+    }
+
+    if (pass == 0 && int(fcache.size() + missing.size()) > max_evals){
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/**
+   Returns the largest magnitude of the surplus over the quantities
+
+   @param delta the surplus of each quantity
+*/
+double AdaptiveQuadrature::indicator( const scalar *delta ){
+  double eta = 0.0;
+  for (int k = 0; k < nfuncs; k++){
+    if (fabs(RealPart(delta[k])) > eta){
+      eta = fabs(RealPart(delta[k]));
+    }
+  }
+  return eta;
+}
+
+/**
+   Adapts the sparse grid and integrates the quantities of interest.
+   The candidate index with the largest surplus is refined until the
+   error estimate, the sum of the surpluses of the candidates, drops
+   below tol times the largest integral, or below the absolute
+   tolerance atol. The absolute floor lets quantities with a zero mean
+   (e.g. a centred displacement) converge.
+
+   @param func the quantities of interest
+   @param ctx the context passed to func
+   @param tol the relative tolerance
+   @param max_evals the budget of evaluations of func
+   @param fmean returns the integral (mean) of each quantity
+   @param atol the absolute tolerance
+   @return 0 when the tolerance is met, 1 otherwise
+*/
+int AdaptiveQuadrature::integrate( QuantityOfInterest func, void *ctx,
+                                   double tol, int max_evals,
+                                   scalar *fmean, double atol ){
+  fcache.clear();
+  old_set.clear();
+  active_set.clear();
+
+  std::vector<int> index(nvars, 1);
+  std::vector<scalar> delta(nfuncs);
+  if (computeSurplus(index, func, ctx, max_evals, delta.data())){
+    printf("Error: Adaptive quadrature budget of %d evaluations is too small\n",
+           max_evals);
+    return 1;
+  }
+  active_set[index] = delta;
+
+  int converged = 0;
+  bool exhausted = false;
+  while (true){
+    // Integral and error estimate of the current grid
+    for (int k = 0; k < nfuncs; k++){
+      fmean[k] = 0.0;
+    }
+    std::map<std::vector<int>, std::vector<scalar> >::iterator it, best;
+    for (it = old_set.begin(); it != old_set.end(); it++){
+      for (int k = 0; k < nfuncs; k++){
+        fmean[k] += it->second[k];
+      }
+    }
+    error_estimate = 0.0;
+    best = active_set.end();
+    for (it = active_set.begin(); it != active_set.end(); it++){
+      for (int k = 0; k < nfuncs; k++){
+        fmean[k] += it->second[k];
+      }
+      double eta = indicator(it->second.data());
+      error_estimate += eta;
+      if (best == active_set.end() || eta > indicator(best->second.data())){
+        best = it;
+      }
+    }
+
+    double etol = tol*indicator(fmean);
+    if (etol < atol){
+      etol = atol;
+    }
+    if (error_estimate <= etol){
+      converged = 1;
+      break;
+    }
+    if (exhausted || best == active_set.end()){
+      break;
+    }
+
+    // Refine the index with the largest surplus
+    index = best->first;
+    old_set[index] = best->second;
+    active_set.erase(best);
+
+    for (int i = 0; i < nvars && !exhausted; i++){
+      std::vector<int> fwd = index;
+      fwd[i]++;
+      if (pc->getParameter(i)->getQuadratureSize(fwd[i]) <= 0){
+        continue;
+      }
+
+      // Admissible when all the backward neighbors are refined
+      bool admissible = true;
+      for (int j = 0; j < nvars; j++){
+        if (fwd[j] > 1){
+          fwd[j]--;
+          if (!old_set.count(fwd)){
+            admissible = false;
+          }
+          fwd[j]++;
+        }
+      }
+      if (admissible){
+        if (computeSurplus(fwd, func, ctx, max_evals, delta.data())){
+          exhausted = true;
+        } else {
+          active_set[fwd] = delta;
+        }
+      }
+    }
+  }
+
+  if (!converged){
+    printf("Warning: Adaptive quadrature stopped with error estimate %e "
+           "after %d evaluations\n", error_estimate, getNumEvaluations());
+  }
+
+  return converged ? 0 : 1;
+}
+
+/**
+   Returns the error estimate, the sum of the surpluses of the
+   candidate indices
+*/
+double AdaptiveQuadrature::getErrorEstimate(){
+  return this->error_estimate;
+}
+
+/**
+   Returns the number of evaluations of the quantities of interest
+*/
+int AdaptiveQuadrature::getNumEvaluations(){
+  return this->fcache.size();
+}
+
+/**
+   Returns the number of level indices in the adapted grid
+*/
+int AdaptiveQuadrature::getNumLevels(){
+  return this->old_set.size() + this->active_set.size();
+}
+
+/**
+   Returns the level indices of the adapted grid, a downward closed
+   set with levels[k*nvars + i] the level of parameter i in index k
+
+   @param levels returns the level indices
+*/
+void AdaptiveQuadrature::getLevels( int *levels ){
+  int k = 0;
+  std::map<std::vector<int>, std::vector<scalar> >::iterator it;
+  for (it = old_set.begin(); it != old_set.end(); it++, k++){
+    for (int i = 0; i < nvars; i++){
+      levels[k*nvars + i] = it->first[i];
+    }
+  }
+  for (it = active_set.begin(); it != active_set.end(); it++, k++){
+    for (int i = 0; i < nvars; i++){
+      levels[k*nvars + i] = it->first[i];
+    }
+  }
+}
@@ -1,8 +1,8 @@
 #include<stdio.h>
-#include<map>
+#include<stdlib.h>
+#include<vector>
 
 #include"BasisHelper.h"
-#include"ArrayList.h"
 
 using namespace std;
 
@@ -22,563 +22,144 @@ BasisHelper::BasisHelper( int _basis_type ){
 BasisHelper::~BasisHelper(){}
 
 /**
-  Return the degree index set and number of indices corresponding to
-  maximum degrees of each parameter.
+  Returns the largest total degree retained in the basis: the sum of
+  maximum degrees for tensor basis and the largest maximum degree for
+  complete basis
 
   @param nvars number of variables (parameters)
   @param pmax maximum degree of each variable (parameter)
-  @param nbasis returns the number of basis entries
-  @param basis_degrees returns the index set for each basis
 */
-void BasisHelper::basisDegrees( const int nvars,
-                                const int *pmax,
-                                int *nbasis,
-                                int **basis_degrees ){
-  if ( nvars == 1 ) {
-    uniVariateBasisDegrees(nvars, pmax, nbasis, basis_degrees);
-  } else if ( nvars == 2 ) {
-    if (this->basis_type == 0) {
-      biVariateBasisDegreesTensor(nvars, pmax, nbasis, basis_degrees);
-    } else {
-      biVariateBasisDegreesComplete(nvars, pmax, nbasis, basis_degrees);
-    }
-  } else if ( nvars == 3 ) {
-    if (this->basis_type == 0) {
-      triVariateBasisDegreesTensor(nvars, pmax, nbasis, basis_degrees);
-    } else {
-      triVariateBasisDegreesComplete(nvars, pmax, nbasis, basis_degrees);
-    }
-  } else if ( nvars == 4 ) {
-    if (this->basis_type == 0) {
-      quadVariateBasisDegreesTensor(nvars, pmax, nbasis, basis_degrees);
-    } else {
-      quadVariateBasisDegreesComplete(nvars, pmax, nbasis, basis_degrees);
-    }
-  } else if ( nvars == 5 ) {
-    if (this->basis_type == 0) {
-      pentaVariateBasisDegreesTensor(nvars, pmax, nbasis, basis_degrees);
-    } else {
-      pentaVariateBasisDegreesComplete(nvars, pmax, nbasis, basis_degrees);
-    }
-  } else {
-    printf("Multivariate basis construction is not implemented for %d variables\n", nvars);
-  }
-}
-
-/**
-  Helps determine whether the evaluation is necessary as many terms
-  are non-zero in jacobian matrix
-
-  @param dmapi degree of i-th entry of jacobian
-  @param dmapj degree of j-th entry of jacobian
-  @param dmapf degree of integrand
-*/
-void BasisHelper::sparse( const int nvars,
-                          int *dmapi,
-                          int *dmapj,
-                          int *dmapk,
-                          bool *filter ){
-  for( int i = 0; i < nvars; i++ ){
-    if (abs(dmapi[i] - dmapj[i]) <= dmapk[i]){
-      filter[i] = true;
-    } else {
-      filter[i] = false;
-    }
-  }
-}
-
-/**
-   Function that constructs a uni-variate basis
-
-   @param nvars number of variables (parameters)
-   @param pmax maximum degree of each variable (parameter)
-   @param nbasis returns the number of basis entries
-   @param basis_degrees returns the index set for each basis
-*/
-void BasisHelper::uniVariateBasisDegrees( const int nvars,
-                                          const int *pmax,
-                                          int *nbasis,
-                                          int **basis_degrees ){
-  // Number of terms from tensor product
-  int nterms = 1;
+int BasisHelper::getMaxTotalDegree( const int nvars, const int *pmax ){
+  int tmax = 0;
   for (int i = 0; i < nvars; i++){
-    nterms *= 1 + pmax[i];
-  }
-
-  int num_total_degrees = 1;
-  for (int i = 0; i < nvars; i++){
-    num_total_degrees += pmax[i];
-  }
-
-  // Create a map of empty array lists
-  std::map<int,ArrayList*> dmap;
-  for (int k = 0; k < num_total_degrees; k++){
-    dmap.insert(pair<int, ArrayList*>(k, new ArrayList(nterms, nvars)));
-  }
-
-  // Add degree wise tuples into each arraylist
-  for (int ii = 0; ii <= pmax[0]; ii++){
-    int tuple[] = {ii};
-    dmap[ii]->addEntry(tuple);
-  }
-
-  int ctr = 0;
-  for (int k = 0; k < num_total_degrees; k++){
-    int nrecords = dmap[k]->getNumEntries();
-    dmap[k]->getEntries(&basis_degrees[ctr]);
-    ctr = ctr + nrecords;
-  }
-  nbasis[0] = ctr;
-
-  // Delete the array lists
-  for (int k = 0; k < num_total_degrees; k++){
-    delete dmap[k];
-  }
-}
-
-/**
-   Function that constructs a bi-variate basis
-
-   @param nvars number of variables (parameters)
-   @param pmax maximum degree of each variable (parameter)
-   @param nbasis returns the number of basis entries
-   @param basis_degrees returns the index set for each basis
-*/
-void BasisHelper::biVariateBasisDegreesTensor( const int nvars,
-                                               const int *pmax,
-                                               int *nbasis,
-                                               int **basis_degrees ){
-  // Number of terms from tensor product
-  int nterms = 1;
-  for (int i = 0; i < nvars; i++){
-    nterms *= 1 + pmax[i];
-  }
-
-  int num_total_degrees = 1;
-  for (int i = 0; i < nvars; i++){
-    num_total_degrees += pmax[i];
-  }
-
-  // Create a map of empty array lists
-  std::map<int,ArrayList*> dmap;
-  for (int k = 0; k < num_total_degrees; k++){
-    dmap.insert(pair<int, ArrayList*>(k, new ArrayList(nterms, nvars)));
-  }
-
-  // Add degree wise tuples into each arraylist
-  for (int ii = 0; ii <= pmax[0]; ii++){
-    for (int jj = 0; jj <= pmax[1]; jj++){
-      int tuple[] = {ii,jj};
-      dmap[ii+jj]->addEntry(tuple);
+    if (this->basis_type == 0){
+      tmax += pmax[i];
+    } else if (pmax[i] > tmax){
+      tmax = pmax[i];
     }
   }
-
-  int ctr = 0;
-  for (int k = 0; k < num_total_degrees; k++){
-    int nrecords = dmap[k]->getNumEntries();
-    dmap[k]->getEntries(&basis_degrees[ctr]);
-    ctr = ctr + nrecords;
-  }
-  nbasis[0] = ctr;
-
-  // Delete the array lists
-  for (int k = 0; k < num_total_degrees; k++){
-    delete dmap[k];
-  }
+  return tmax;
 }
 
 /**
-   Function that constructs a tri-variate basis
+  Returns the number of multivariate basis terms, counting the degree
+  tuples with each entry bounded by pmax and the total degree bounded
+  by the largest total degree of the basis type
 
-   @param nvars number of variables (parameters)
-   @param pmax maximum degree of each variable (parameter)
-   @param nbasis returns the number of basis entries
-   @param basis_degrees returns the index set for each basis
+  @param nvars number of variables (parameters)
+  @param pmax maximum degree of each variable (parameter)
 */
-void BasisHelper::triVariateBasisDegreesTensor( const int nvars,
-                                                const int *pmax,
-                                                int *nbasis,
-                                                int **basis_degrees ){
-  // Number of terms from tensor product
-  int nterms = 1;
-  for (int i = 0; i < nvars; i++){
-    nterms *= 1 + pmax[i];
-  }
+int BasisHelper::getNumBasisTerms( const int nvars, const int *pmax ){
+  const int tmax = getMaxTotalDegree(nvars, pmax);
 
-  int num_total_degrees = 1;
+  // count[t] is the number of tuples of the first i variables with
+  // total degree t
+  std::vector<long> count(tmax+1, 0), next(tmax+1, 0);
+  count[0] = 1;
   for (int i = 0; i < nvars; i++){
-    num_total_degrees += pmax[i];
-  }
-
-  // Create a map of empty array lists
-  std::map<int,ArrayList*> dmap;
-  for (int k = 0; k < num_total_degrees; k++){
-    dmap.insert(pair<int, ArrayList*>(k, new ArrayList(nterms, nvars)));
-  }
-
-  // Add degree wise tuples into each arraylist
-  for (int ii = 0; ii <= pmax[0]; ii++){
-    for (int jj = 0; jj <= pmax[1]; jj++){
-      for (int kk = 0; kk <= pmax[2]; kk++){
-        int tuple[] = {ii,jj,kk};
-        dmap[ii+jj+kk]->addEntry(tuple);
+    for (int t = 0; t <= tmax; t++){
+      long sum = 0;
+      for (int d = 0; d <= pmax[i] && d <= t; d++){
+        sum += count[t-d];
       }
+      next[t] = sum;
     }
+    count.swap(next);
   }
 
-  int ctr = 0;
-  for (int k = 0; k < num_total_degrees; k++){
-    int nrecords = dmap[k]->getNumEntries();
-    dmap[k]->getEntries(&basis_degrees[ctr]);
-    ctr = ctr + nrecords;
-  }
-  nbasis[0] = ctr;
-
-  // Delete the array lists
-  for (int k = 0; k < num_total_degrees; k++){
-    delete dmap[k];
+  long nterms = 0;
+  for (int t = 0; t <= tmax; t++){
+    nterms += count[t];
   }
+  return int(nterms);
 }
 
 /**
-   Function that constructs a quadVariate basis
-
-   @param nvars number of variables (parameters)
-   @param pmax maximum degree of each variable (parameter)
-   @param nbasis returns the number of basis entries
-   @param basis_degrees returns the index set for each basis
-*/
-void BasisHelper::quadVariateBasisDegreesTensor( const int nvars,
-                                                 const int *pmax,
-                                                 int *nbasis,
-                                                 int **basis_degrees ){
-  // Number of terms from tensor product
-  int nterms = 1;
-  for (int i = 0; i < nvars; i++){
-    nterms *= 1 + pmax[i];
-  }
-
-  int num_total_degrees = 1;
-  for (int i = 0; i < nvars; i++){
-    num_total_degrees += pmax[i];
-  }
-
-  // Create a map of empty array lists
-  std::map<int,ArrayList*> dmap;
-  for (int k = 0; k < num_total_degrees; k++){
-    dmap.insert(pair<int, ArrayList*>(k, new ArrayList(nterms, nvars)));
-  }
-
-  // Add degree wise tuples into each arraylist
-  for (int ii = 0; ii <= pmax[0]; ii++){
-    for (int jj = 0; jj <= pmax[1]; jj++){
-      for (int kk = 0; kk <= pmax[2]; kk++){
-        for (int ll = 0; ll <= pmax[3]; ll++){
-          int tuple[] = {ii,jj,kk,ll};
-          dmap[ii+jj+kk+ll]->addEntry(tuple);
-        }
-      }
-    }
-  }
-
-  int ctr = 0;
-  for (int k = 0; k < num_total_degrees; k++){
-    int nrecords = dmap[k]->getNumEntries();
-    dmap[k]->getEntries(&basis_degrees[ctr]);
-    ctr = ctr + nrecords;
-  }
-  nbasis[0] = ctr;
-
-  // Delete the array lists
-  for (int k = 0; k < num_total_degrees; k++){
-    delete dmap[k];
-  }
-}
+  Return the degree index set and number of indices corresponding to
+  maximum degrees of each parameter.
 
-/**
-   Function that constructs a penta-variate basis using tensor product
-   rule.
+  The tuples are generated in graded order: by increasing total
+  degree, and lexicographically (first variable most significant)
+  within each total degree. Each tuple follows from the previous one
+  in O(nvars) operations, and is written directly into the flat array
+  basis_degrees[k*nvars + i] of size getNumBasisTerms()*nvars.
 
-   @param nvars number of variables (parameters)
-   @param pmax maximum degree of each variable (parameter)
-   @param nbasis returns the number of basis entries
-   @param basis_degrees returns the index set for each basis
+  @param nvars number of variables (parameters)
+  @param pmax maximum degree of each variable (parameter)
+  @param nbasis returns the number of basis entries
+  @param basis_degrees returns the index set for each basis
 */
-void BasisHelper::pentaVariateBasisDegreesTensor( const int nvars,
-                                                  const int *pmax,
-                                                  int *nbasis,
-                                                  int **basis_degrees ){
-  // Number of terms from tensor product
-  int nterms = 1;
-  for (int i = 0; i < nvars; i++){
-    nterms *= 1 + pmax[i];
-  }
+void BasisHelper::basisDegrees( const int nvars,
+                                const int *pmax,
+                                int *nbasis,
+                                int *basis_degrees ){
+  const int tmax = getMaxTotalDegree(nvars, pmax);
 
-  int num_total_degrees = 1;
+  int capacity = 0;
   for (int i = 0; i < nvars; i++){
-    num_total_degrees += pmax[i];
-  }
-
-  // Create a map of empty array lists
-  std::map<int,ArrayList*> dmap;
-  for (int k = 0; k < num_total_degrees; k++){
-    dmap.insert(pair<int, ArrayList*>(k, new ArrayList(nterms, nvars)));
-  }
-
-  // Add degree wise tuples into each arraylist
-  for (int ii = 0; ii <= pmax[0]; ii++){
-    for (int jj = 0; jj <= pmax[1]; jj++){
-      for (int kk = 0; kk <= pmax[2]; kk++){
-        for (int ll = 0; ll <= pmax[3]; ll++){
-          for (int mm = 0; mm <= pmax[4]; mm++){
-            int tuple[] = {ii,jj,kk,ll,mm};
-            dmap[ii+jj+kk+ll+mm]->addEntry(tuple);
-          }
-        }
-      }
-    }
+    capacity += pmax[i];
   }
 
+  std::vector<int> tuple(nvars);
   int ctr = 0;
-  for (int k = 0; k < num_total_degrees; k++){
-    int nrecords = dmap[k]->getNumEntries();
-    dmap[k]->getEntries(&basis_degrees[ctr]);
-    ctr = ctr + nrecords;
-  }
-  nbasis[0] = ctr;
-
-  // Delete the array lists
-  for (int k = 0; k < num_total_degrees; k++){
-    delete dmap[k];
-  }
-}
-
-/**
-   Compute the factorial of an integer
-
-   @param n integer number for factorial
-*/
-int factorial(const int n) {
-  unsigned long long fact = 1;
-  for(int i = 1; i <=n; ++i){
-    fact *= i;
-  }
-  return (int) fact;
-}
-
-/**
-   Returns the maximum of an array
-
-   @param n length of array
-   @param vals values
- */
-int maxval(const int n, const int *vals){
-  int mval = vals[0];
-  for(int i = 1; i < n; i++){
-    if (vals[i] > mval) {
-      mval = vals[i];
+  for (int t = 0; t <= tmax && t <= capacity; t++){
+
+    // The smallest tuple of total degree t packs the degrees into the
+    // last variables
+    int r = t;
+    for (int i = nvars-1; i >= 0; i--){
+      tuple[i] = (r < pmax[i]) ? r : pmax[i];
+      r -= tuple[i];
     }
-  }
-  return mval;
-}
-
-/**
-   Creates bi-variate basis using complete polynomial rule
-
-   @param nvars number of variables (parameters)
-   @param pmax maximum degree of each variable (parameter)
-   @param nbasis returns the number of basis entries
-   @param basis_degrees returns the index set for each basis
-*/
-void BasisHelper::biVariateBasisDegreesComplete( const int nvars,
-                                                 const int *pmax,
-                                                 int *nbasis,
-                                                 int **basis_degrees ){
-  // Number of terms from factorials
-  int maxpmax = maxval(nvars, pmax);
-  int nterms = factorial(nvars+maxpmax)/(factorial(nvars)*factorial(maxpmax));
-
-  // Create a map of empty array lists
-  std::map<int,ArrayList*> dmap;
-  for (int k = 0; k <= maxpmax; k++){
-    dmap.insert(pair<int, ArrayList*>(k, new ArrayList(nterms, nvars)));
-  }
 
-  // Add degree wise tuples into each arraylist
-  for (int ii = 0; ii <= pmax[0]; ii++){
-    for (int jj = 0; jj <= pmax[1]; jj++){
-      int dsum = ii+jj;
-      if (dsum <= maxpmax){
-        int tuple[] = {ii,jj}; // nvars
-        dmap[dsum]->addEntry(tuple);
+    while (true){
+      for (int i = 0; i < nvars; i++){
+        basis_degrees[ctr*nvars + i] = tuple[i];
       }
-    }
-  }
-
-  // Fill the basis_degrees array with basis entries of increasing degree
-  int ctr = 0;
-  for (int k = 0; k <= maxpmax; k++){
-    int nbasis = dmap[k]->getNumEntries(); // of degree k
-    dmap[k]->getEntries(&basis_degrees[ctr]);
-    ctr = ctr + nbasis; // add nbasis
-  }
-  nbasis[0] = ctr;
-
-  // Delete the array lists
-  for (int k = 0; k <= maxpmax; k++){
-    delete dmap[k];
-  }
-}
-
-/**
-   Creates tri-variate basis using complete polynomial rule
-
-   @param nvars number of variables (parameters)
-   @param pmax maximum degree of each variable (parameter)
-   @param nbasis returns the number of basis entries
-   @param basis_degrees returns the index set for each basis
-*/
-void BasisHelper::triVariateBasisDegreesComplete( const int nvars,
-                                                  const int *pmax,
-                                                  int *nbasis,
-                                                  int **basis_degrees ){
-  // Number of terms from factorials
-  int maxpmax = maxval(nvars, pmax);
-  int nterms = factorial(nvars+maxpmax)/(factorial(nvars)*factorial(maxpmax));
-
-  // Create a map of empty array lists
-  std::map<int,ArrayList*> dmap;
-  for (int k = 0; k <= maxpmax; k++){
-    dmap.insert(pair<int, ArrayList*>(k, new ArrayList(nterms, nvars)));
-  }
-
-  // Add degree wise tuples into each arraylist
-  for (int ii = 0; ii <= pmax[0]; ii++){
-    for (int jj = 0; jj <= pmax[1]; jj++){
-      for (int kk = 0; kk <= pmax[2]; kk++){
-        int dsum = ii+jj+kk;
-        if (dsum <= maxpmax){
-          int tuple[] = {ii,jj,kk};
-          dmap[dsum]->addEntry(tuple);
-        }
+      ctr++;
+
+      // Find the rightmost variable that can be incremented by
+      // moving one degree from the variables after it
+      int i = nvars - 2;
+      int suffix = tuple[nvars-1];
+      while (i >= 0 && (tuple[i] >= pmax[i] || suffix == 0)){
+        suffix += tuple[i];
+        i--;
       }
-    }
-  }
-
-  int ctr = 0;
-  for (int k = 0; k <= maxpmax; k++){
-    int nrecords = dmap[k]->getNumEntries();
-    dmap[k]->getEntries(&basis_degrees[ctr]);
-    ctr = ctr + nrecords;
-  }
-  nbasis[0] = ctr;
-
-  // Delete the array lists
-  for (int k = 0; k <= maxpmax; k++){
-    delete dmap[k];
-  }
-}
-
-/**
-   Creates quad-variate basis using complete polynomial rule
-
-   @param nvars number of variables (parameters)
-   @param pmax maximum degree of each variable (parameter)
-   @param nbasis returns the number of basis entries
-   @param basis_degrees returns the index set for each basis
-*/
-void BasisHelper::quadVariateBasisDegreesComplete( const int nvars,
-                                                   const int *pmax,
-                                                   int *nbasis,
-                                                   int **basis_degrees ){
-  // Number of terms from factorials
-  int maxpmax = maxval(nvars, pmax);
-  int nterms = factorial(nvars+maxpmax)/(factorial(nvars)*factorial(maxpmax));
-
-  // Create a map of empty array lists
-  std::map<int,ArrayList*> dmap;
-  for (int k = 0; k <= maxpmax; k++){
-    dmap.insert(pair<int, ArrayList*>(k, new ArrayList(nterms, nvars)));
-  }
+      if (i < 0){
+        break;
+      }
+      tuple[i]++;
 
-  // Add degree wise tuples into each arraylist
-  for (int ii = 0; ii <= pmax[0]; ii++){
-    for (int jj = 0; jj <= pmax[1]; jj++){
-      for (int kk = 0; kk <= pmax[2]; kk++){
-        for (int ll = 0; ll <= pmax[3]; ll++){
-          int dsum = ii+jj+kk+ll;
-          if (dsum <= maxpmax){
-            int tuple[] = {ii,jj,kk,ll};
-            dmap[dsum]->addEntry(tuple);
-          }
-        }
+      // Pack the remaining degrees into the last variables
+      r = suffix - 1;
+      for (int j = nvars-1; j > i; j--){
+        tuple[j] = (r < pmax[j]) ? r : pmax[j];
+        r -= tuple[j];
       }
     }
   }
-
-  int ctr = 0;
-  for (int k = 0; k <= maxpmax; k++){
-    int nrecords = dmap[k]->getNumEntries();
-    dmap[k]->getEntries(&basis_degrees[ctr]);
-    ctr = ctr + nrecords;
-  }
   nbasis[0] = ctr;
-
-  // Delete the array lists
-  for (int k = 0; k <= maxpmax; k++){
-    delete dmap[k];
-  }
 }
 
 /**
-   Creates pentaVariate basis using complete polynomial rule
+  Helps determine whether the evaluation is necessary as many terms
+  are non-zero in jacobian matrix
 
-   @param nvars number of variables (parameters)
-   @param pmax maximum degree of each variable (parameter)
-   @param nbasis returns the number of basis entries
-   @param basis_degrees returns the index set for each basis
+  @param dmapi degree of i-th entry of jacobian
+  @param dmapj degree of j-th entry of jacobian
+  @param dmapf degree of integrand
 */
-void BasisHelper::pentaVariateBasisDegreesComplete( const int nvars,
-                                                    const int *pmax,
-                                                    int *nbasis,
-                                                    int **basis_degrees ){
-  // Number of terms from factorials
-  int maxpmax = maxval(nvars, pmax);
-  int nterms = factorial(nvars+maxpmax)/(factorial(nvars)*factorial(maxpmax));
-
-  // Create a map of empty array lists
-  std::map<int,ArrayList*> dmap;
-  for (int k = 0; k <= maxpmax; k++){
-    dmap.insert(pair<int, ArrayList*>(k, new ArrayList(nterms, nvars)));
-  }
-
-  // Add degree wise tuples into each arraylist
-  for (int ii = 0; ii <= pmax[0]; ii++){
-    for (int jj = 0; jj <= pmax[1]; jj++){
-      for (int kk = 0; kk <= pmax[2]; kk++){
-        for (int ll = 0; ll <= pmax[3]; ll++){
-          for (int mm = 0; mm <= pmax[4]; mm++){
-            int dsum = ii+jj+kk+ll+mm;
-            if (dsum <= maxpmax){
-              int tuple[] = {ii,jj,kk,ll,mm};
-              dmap[dsum]->addEntry(tuple);
-            }
-          }
-        }
-      }
+void BasisHelper::sparse( const int nvars,
+                          int *dmapi,
+                          int *dmapj,
+                          int *dmapk,
+                          bool *filter ){
+  for( int i = 0; i < nvars; i++ ){
+    if (abs(dmapi[i] - dmapj[i]) <= dmapk[i]){
+      filter[i] = true;
+    } else {
+      filter[i] = false;
     }
   }
-
-  int ctr = 0;
-  for (int k = 0; k <= maxpmax; k++){
-    int nrecords = dmap[k]->getNumEntries();
-    dmap[k]->getEntries(&basis_degrees[ctr]);
-    ctr = ctr + nrecords;
-  }
-  nbasis[0] = ctr;
-
-  // Delete the array lists
-  for (int k = 0; k <= maxpmax; k++){
-    delete dmap[k];
-  }
 }
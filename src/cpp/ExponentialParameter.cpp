@@ -42,3 +42,30 @@ void ExponentialParameter::quadrature(int npoints, scalar *z, scalar *y, scalar
 scalar ExponentialParameter::basis(scalar z, int d){
   return this->polyn->unit_laguerre(z, d);
 }
+
+/**
+  Evaluate the basis of all orders 0..d at the point z as L(z,0..d)
+
+  @param z point to evaluate the basis function
+  @param d maximum degree of basis function
+  @param phi returns the basis values of each degree
+*/
+void ExponentialParameter::basis(scalar z, int d, scalar *phi){
+  this->polyn->unit_polynomials(OrthogonalPolynomials::LAGUERRE, z, d, phi);
+}
+
+/**
+  Evaluate the basis of all orders 0..d at an array of points as
+  L(z[p],k) stored in phi[k*ldphi + p]
+
+  @param npts number of points
+  @param z points to evaluate the basis function
+  @param d maximum degree of basis function
+  @param phi returns the basis values of each degree at each point
+  @param ldphi leading dimension of phi
+*/
+void ExponentialParameter::basis(int npts, const scalar *z, int d,
+                        scalar *phi, int ldphi){
+  this->polyn->unit_polynomials(OrthogonalPolynomials::LAGUERRE, npts, z, d,
+                                phi, ldphi);
+}
@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include "MatrixKernels.h"
+
+#ifdef PSPACE_USE_CBLAS
+#include <cblas.h>
+#endif
+
+namespace{
+  // Tile sizes of the blocked product (rows, inner, columns)
+  const int MB = 64;
+  const int KB = 128;
+  const int NB = 256;
+
+  /*
+    Blocked product C += alpha*op(A)*op(B) after C was scaled by beta.
+    Each tile of op(A) is applied to a contiguous range of the rows of
+    C, so the innermost loop runs with unit stride when B is not
+    transposed.
+  */
+  void gemmBlocked( int transa, int transb, int m, int n, int k,
+                    scalar alpha, const scalar *A, int lda,
+                    const scalar *B, int ldb, scalar *C, int ldc ){
+    for ( int i0 = 0; i0 < m; i0 += MB ){
+      const int i1 = (i0 + MB < m) ? i0 + MB : m;
+      for ( int l0 = 0; l0 < k; l0 += KB ){
+        const int l1 = (l0 + KB < k) ? l0 + KB : k;
+        for ( int j0 = 0; j0 < n; j0 += NB ){
+          const int j1 = (j0 + NB < n) ? j0 + NB : n;
+          for ( int i = i0; i < i1; i++ ){
+            scalar *Ci = &C[size_t(i)*ldc];
+            for ( int l = l0; l < l1; l++ ){
+              const scalar a = alpha*(transa ? A[size_t(l)*lda + i] :
+                                      A[size_t(i)*lda + l]);
+              if (a == 0.0){
+                continue;
+              }
+              if (transb){
+                for ( int j = j0; j < j1; j++ ){
+                  Ci[j] += a*B[size_t(j)*ldb + l];
+                }
+              } else {
+                const scalar *Bl = &B[size_t(l)*ldb];
+                for ( int j = j0; j < j1; j++ ){
+                  Ci[j] += a*Bl[j];
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+/**
+   Computes C = alpha*op(A)*op(B) + beta*C for row-major matrices.
+   When beta is zero, C need not be initialized.
+
+   @param transa use the transpose of A (k x m) when nonzero
+   @param transb use the transpose of B (n x k) when nonzero
+   @param m the number of rows of C
+   @param n the number of columns of C
+   @param k the inner dimension
+   @param alpha the scaling of the product
+   @param A the matrix A with leading dimension lda
+   @param B the matrix B with leading dimension ldb
+   @param beta the scaling of C
+   @param C the matrix C with leading dimension ldc
+*/
+void MatrixKernels::gemm( int transa, int transb, int m, int n, int k,
+                          scalar alpha, const scalar *A, int lda,
+                          const scalar *B, int ldb,
+                          scalar beta, scalar *C, int ldc ){
+  if (m <= 0 || n <= 0){
+    return;
+  }
+
+#ifdef PSPACE_USE_CBLAS
+  const CBLAS_TRANSPOSE ta = transa ? CblasTrans : CblasNoTrans;
+  const CBLAS_TRANSPOSE tb = transb ? CblasTrans : CblasNoTrans;
+#ifdef USE_COMPLEX
+  cblas_zgemm(CblasRowMajor, ta, tb, m, n, k, &alpha, A, lda, B, ldb,
+              &beta, C, ldc);
+#else
+  cblas_dgemm(CblasRowMajor, ta, tb, m, n, k, alpha, A, lda, B, ldb,
+              beta, C, ldc);
+#endif // USE_COMPLEX
+#else
+  for ( int i = 0; i < m; i++ ){
+    scalar *Ci = &C[size_t(i)*ldc];
+    if (beta == 0.0){
+      for ( int j = 0; j < n; j++ ){
+        Ci[j] = 0.0;
+      }
+    } else if (beta != 1.0){
+      for ( int j = 0; j < n; j++ ){
+        Ci[j] *= beta;
+      }
+    }
+  }
+  if (k > 0 && alpha != 0.0){
+    gemmBlocked(transa, transb, m, n, k, alpha, A, lda, B, ldb, C, ldc);
+  }
+#endif // PSPACE_USE_CBLAS
+}
+
+/**
+   Returns the name of the backend performing the products
+*/
+const char* MatrixKernels::getBackend(){
+#ifdef PSPACE_USE_CBLAS
+  return "cblas";
+#else
+  return "blocked";
+#endif
+}
@@ -0,0 +1,482 @@
+/**
+  Class to return points and weights of nested quadrature rules
+
+  Author: Komahan Boopathy (komahanboopathy@gmail.com)
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include "NestedQuadrature.h"
+#include "GaussianQuadrature.h"
+#include "OrthogonalPolynomials.h"
+
+namespace{
+  /*
+    Points and weights of a rule in the standard probabilistic domain
+  */
+  struct QuadratureRule {
+    std::vector<double> z;
+    std::vector<double> w;
+  };
+
+  /*
+    Orthonormal polynomials of degree 0..d at the point x from the
+    recurrence coefficients
+  */
+  void orthonormal( const double *alpha, const double *beta,
+                    double x, int d, double *phi ){
+    phi[0] = 1.0;
+    if ( d > 0 ){
+      phi[1] = (x - alpha[0])/beta[1];
+    }
+    for ( int k = 1; k < d; k++ ){
+      phi[k+1] = ((x - alpha[k])*phi[k] - beta[k]*phi[k-1])/beta[k+1];
+    }
+  }
+
+  /*
+    Solve the dense system A x = b with partial pivoting. A (n x n,
+    row major) and b are destroyed and x is returned in b.
+  */
+  int solve( int n, double *A, double *b ){
+    for ( int k = 0; k < n; k++ ){
+      int piv = k;
+      for ( int i = k+1; i < n; i++ ){
+        if ( fabs(A[i*n + k]) > fabs(A[piv*n + k]) ) piv = i;
+      }
+      if ( A[piv*n + k] == 0.0 ) return 1;
+      if ( piv != k ){
+        for ( int j = 0; j < n; j++ ){
+          std::swap(A[k*n + j], A[piv*n + j]);
+        }
+        std::swap(b[k], b[piv]);
+      }
+      for ( int i = k+1; i < n; i++ ){
+        double f = A[i*n + k]/A[k*n + k];
+        for ( int j = k; j < n; j++ ){
+          A[i*n + j] -= f*A[k*n + j];
+        }
+        b[i] -= f*b[k];
+      }
+    }
+    for ( int k = n-1; k >= 0; k-- ){
+      for ( int j = k+1; j < n; j++ ){
+        b[k] -= A[k*n + j]*b[j];
+      }
+      b[k] /= A[k*n + k];
+    }
+    return 0;
+  }
+}
+
+/**
+  Constructor for nested quadrature
+*/
+NestedQuadrature::NestedQuadrature(){}
+
+/**
+  Destructor for nested quadrature
+*/
+NestedQuadrature::~NestedQuadrature(){}
+
+/**
+  Returns the number of points of a nested rule at a level. The
+  Clenshaw-Curtis rules double the intervals, the Gauss-Patterson
+  rules double the points plus one and the Genz-Keister rules follow
+  the sizes 1, 3, 9, 19, 35 of the Hermite extensions of Genz and
+  Keister. These are not all positive weight rules: the 19 point rule
+  has a negative weight.
+
+  @param rule the nested rule family
+  @param level the level of the rule (1, 2, ...)
+*/
+int NestedQuadrature::getNumPoints( int rule, int level ){
+  if ( level < 1 || level > getMaxLevel(rule) ){
+    return 0;
+  }
+  if ( rule == CLENSHAW_CURTIS ){
+    return (level == 1) ? 1 : (1 << (level-1)) + 1;
+  } else if ( rule == GAUSS_PATTERSON ){
+    return (1 << level) - 1;
+  }
+  static const int genz_keister[] = {1, 3, 9, 19, 35};
+  return genz_keister[level-1];
+}
+
+/**
+  Returns the polynomial degree integrated exactly by a nested rule at
+  a level. The symmetric rules with an odd number of points also
+  integrate the next odd degree.
+
+  @param rule the nested rule family
+  @param level the level of the rule (1, 2, ...)
+*/
+int NestedQuadrature::getDegree( int rule, int level ){
+  if ( level < 1 || level > getMaxLevel(rule) ){
+    return -1;
+  }
+  if ( rule == CLENSHAW_CURTIS ){
+    return getNumPoints(rule, level);
+  } else if ( rule == GAUSS_PATTERSON ){
+    return (level == 1) ? 1 : 3*(1 << (level-1)) - 1;
+  }
+  static const int genz_keister[] = {1, 5, 15, 29, 51};
+  return genz_keister[level-1];
+}
+
+/**
+  Returns the number of levels available for a nested rule
+
+  @param rule the nested rule family
+*/
+int NestedQuadrature::getMaxLevel( int rule ){
+  if ( rule == CLENSHAW_CURTIS ){
+    return 10;
+  } else if ( rule == GAUSS_PATTERSON ){
+    return 6;
+  } else if ( rule == GENZ_KEISTER ){
+    return 5;
+  }
+  return 0;
+}
+
+/**
+  Returns the level of the rule with npoints, or -1 when npoints is not
+  a size of the rule
+
+  @param rule the nested rule family
+  @param npoints the number of points
+*/
+int NestedQuadrature::getLevel( int rule, int npoints ){
+  for ( int level = 1; level <= getMaxLevel(rule); level++ ){
+    if ( getNumPoints(rule, level) == npoints ){
+      return level;
+    }
+  }
+  return -1;
+}
+
+/**
+  Clenshaw-Curtis rule on [0,1] with npoints at the extrema of the
+  Chebyshev polynomials. The weights are normalized to sum to one.
+
+  @param npoints the number of points
+  @param z returns the points
+  @param w returns the weights
+*/
+void NestedQuadrature::computeClenshawCurtis( int npoints,
+                                              double *z, double *w ){
+  if ( npoints == 1 ){
+    z[0] = 0.5;
+    w[0] = 1.0;
+    return;
+  }
+  const int n = npoints - 1;
+  for ( int j = 0; j <= n; j++ ){
+    const double theta = M_PI*j/n;
+    double s = 0.0;
+    for ( int k = 1; k <= n/2; k++ ){
+      const double b = (2*k == n) ? 1.0 : 2.0;
+      s += b*cos(2.0*k*theta)/(4.0*k*k - 1.0);
+    }
+    const double c = (j == 0 || j == n) ? 1.0 : 2.0;
+    z[j] = 0.5*(1.0 - cos(theta));
+    w[j] = 0.5*c*(1.0 - s)/n;
+  }
+
+  // Enforce the symmetry about the center
+  for ( int j = 0; j < npoints/2; j++ ){
+    z[n-j] = 1.0 - z[j];
+    w[n-j] = w[j];
+  }
+  if ( npoints % 2 == 1 ){
+    z[n/2] = 0.5;
+  }
+}
+
+/**
+  Extend a base rule with new points so that the extended rule with
+  npoints integrates polynomials of the highest possible degree. The
+  new points are the roots of the polynomial q of degree m = npoints -
+  nbase, orthogonal to p*x^k (k < m) where p vanishes at the base
+  points, and the weights follow from interpolation.
+
+  @param family the orthogonal polynomial family of the measure
+  @param nbase the number of points of the base rule
+  @param zbase the points of the base rule
+  @param npoints the number of points of the extended rule
+  @param z returns the points of the extended rule
+  @param w returns the weights of the extended rule
+*/
+void NestedQuadrature::computeExtension( int family,
+                                         int nbase, const double *zbase,
+                                         int npoints, double *z, double *w ){
+  const int m = npoints - nbase;
+  std::vector<double> alpha(npoints+1), beta(npoints+1);
+  OrthogonalPolynomials::recurrence(family, npoints+1,
+                                    alpha.data(), beta.data());
+
+  // Gauss rule integrating p*phi_j*phi_k exactly (degree nbase+2m)
+  const int ng = (nbase + 2*m)/2 + 1;
+  const double *zg, *wg;
+  GaussianQuadrature::getRule(family, ng, &zg, &wg);
+
+  // Orthogonality conditions on q = phi_m + sum_j c_j phi_j
+  double *A = new double[m*m];
+  double *c = new double[m];
+  std::vector<double> phi(npoints+1);
+  for ( int i = 0; i < m*m; i++ ){
+    A[i] = 0.0;
+  }
+  for ( int k = 0; k < m; k++ ){
+    c[k] = 0.0;
+  }
+  for ( int g = 0; g < ng; g++ ){
+    double p = 1.0;
+    for ( int i = 0; i < nbase; i++ ){
+      p *= zg[g] - zbase[i];
+    }
+    orthonormal(alpha.data(), beta.data(), zg[g], m, phi.data());
+    for ( int k = 0; k < m; k++ ){
+      const double wk = wg[g]*p*phi[k];
+      for ( int j = 0; j < m; j++ ){
+        A[k*m + j] += wk*phi[j];
+      }
+      c[k] -= wk*phi[m];
+    }
+  }
+  if ( solve(m, A, c) ){
+    printf("Error: Nested quadrature extension to %d points is singular\n",
+           npoints);
+  }
+
+  // The roots of q lie within the extremes of the Gauss rule
+  const double *zn, *wn;
+  GaussianQuadrature::getRule(family, npoints, &zn, &wn);
+  const double margin = 0.5*(zn[npoints-1] - zn[0]);
+  const double lo = zn[0] - margin, hi = zn[npoints-1] + margin;
+  const int nscan = 200*npoints;
+  double xprev = lo, qprev = 0.0;
+  int nroots = 0;
+  for ( int s = 0; s <= nscan && nroots < m; s++ ){
+    const double x = lo + (hi - lo)*s/nscan;
+    orthonormal(alpha.data(), beta.data(), x, m, phi.data());
+    double q = phi[m];
+    for ( int j = 0; j < m; j++ ){
+      q += c[j]*phi[j];
+    }
+    if ( q == 0.0 ){
+      z[nbase + nroots] = x;
+      nroots++;
+    } else if ( s > 0 && q*qprev < 0.0 ){
+      // Bisect the bracket down to round-off
+      double a = xprev, b = x, qa = qprev;
+      for ( int it = 0; it < 200 && b - a > 0.0; it++ ){
+        const double mid = 0.5*(a + b);
+        if ( mid <= a || mid >= b ) break;
+        orthonormal(alpha.data(), beta.data(), mid, m, phi.data());
+        double qm = phi[m];
+        for ( int j = 0; j < m; j++ ){
+          qm += c[j]*phi[j];
+        }
+        if ( qm*qa <= 0.0 ){
+          b = mid;
+        } else {
+          a = mid;
+          qa = qm;
+        }
+      }
+      z[nbase + nroots] = 0.5*(a + b);
+      nroots++;
+    }
+    xprev = x;
+    qprev = q;
+  }
+  if ( nroots != m ){
+    printf("Error: Nested quadrature extension to %d points found %d of %d "
+           "real points\n", npoints, nroots, m);
+  }
+  for ( int i = 0; i < nbase; i++ ){
+    z[i] = zbase[i];
+  }
+  std::sort(z, z + npoints);
+
+  // Interpolatory weights from the Lagrange polynomials
+  const int nl = npoints/2 + 1;
+  const double *zl, *wl;
+  GaussianQuadrature::getRule(family, nl, &zl, &wl);
+  for ( int j = 0; j < npoints; j++ ){
+    w[j] = 0.0;
+    for ( int g = 0; g < nl; g++ ){
+      double l = 1.0;
+      for ( int i = 0; i < npoints; i++ ){
+        if ( i != j ){
+          l *= (zl[g] - z[i])/(z[j] - z[i]);
+        }
+      }
+      w[j] += wl[g]*l;
+    }
+  }
+
+  // Enforce the symmetry of the rules symmetric about their mean
+  const double center = (family == OrthogonalPolynomials::HERMITE) ? 0.0 : 0.5;
+  for ( int j = 0; j < npoints/2; j++ ){
+    const double d = 0.5*((center - z[j]) + (z[npoints-1-j] - center));
+    const double wj = 0.5*(w[j] + w[npoints-1-j]);
+    z[j] = center - d;
+    z[npoints-1-j] = center + d;
+    w[j] = w[npoints-1-j] = wj;
+  }
+  if ( npoints % 2 == 1 ){
+    z[npoints/2] = center;
+  }
+
+  // Keep the base points bitwise identical so that the rules nest
+  for ( int i = 0; i < nbase; i++ ){
+    int jmin = 0;
+    for ( int j = 1; j < npoints; j++ ){
+      if ( fabs(z[j] - zbase[i]) < fabs(z[jmin] - zbase[i]) ) jmin = j;
+    }
+    z[jmin] = zbase[i];
+  }
+
+  delete [] A;
+  delete [] c;
+}
+
+/**
+  Returns the points and weights of a nested rule at a level in the
+  standard probabilistic domain. The rules of all lower levels are
+  generated along the way and every rule is generated only once.
+
+  @param rule the nested rule family
+  @param level the level of the rule
+  @param z returns the cached points
+  @param w returns the cached weights
+*/
+void NestedQuadrature::getRule( int rule, int level,
+                                const double **z, const double **w ){
+  static std::map<int, std::vector<QuadratureRule> > rule_cache;
+  static std::mutex rule_cache_lock;
+
+  std::lock_guard<std::mutex> guard(rule_cache_lock);
+  std::vector<QuadratureRule> &rules = rule_cache[rule];
+  while ( (int)rules.size() < level ){
+    const int l = rules.size() + 1;
+    const int npoints = getNumPoints(rule, l);
+    QuadratureRule next;
+    next.z.resize(npoints);
+    next.w.resize(npoints);
+    if ( rule == CLENSHAW_CURTIS ){
+      computeClenshawCurtis(npoints, next.z.data(), next.w.data());
+    } else {
+      const int family = (rule == GAUSS_PATTERSON) ?
+        OrthogonalPolynomials::LEGENDRE : OrthogonalPolynomials::HERMITE;
+      if ( l == 1 ){
+        next.z[0] = (family == OrthogonalPolynomials::HERMITE) ? 0.0 : 0.5;
+        next.w[0] = 1.0;
+      } else {
+        const QuadratureRule &base = rules[l-2];
+        computeExtension(family, base.z.size(), base.z.data(),
+                         npoints, next.z.data(), next.w.data());
+      }
+    }
+    rules.push_back(next);
+  }
+  *z = rules[level-1].z.data();
+  *w = rules[level-1].w.data();
+}
+
+/**
+  Clenshaw-Curtis quadrature for uniform parameters
+
+  @param npoints the number of points (1, 3, 5, 9, 17, ...)
+  @param a the lower bound
+  @param b the upper bound
+  @param z returns the points in standard domain
+  @param y returns the points in general domain
+  @param w returns the weights
+*/
+void NestedQuadrature::clenshawCurtisQuadrature( int npoints,
+                                                 scalar a, scalar b,
+                                                 scalar *z, scalar *y, scalar *w ){
+  const int level = getLevel(CLENSHAW_CURTIS, npoints);
+  if ( level < 0 ){
+    printf("Error: Invalid number of Clenshaw-Curtis quadrature points %d\n",
+           npoints);
+    return;
+  }
+  const double *zr, *wr;
+  getRule(CLENSHAW_CURTIS, level, &zr, &wr);
+
+  // Return points in appropriate domains
+  for ( int n = 0; n < npoints; n++ ) {
+    z[n] = zr[n];
+    y[n] = a + (b-a)*zr[n];
+    w[n] = wr[n];
+  }
+}
+
+/**
+  Gauss-Patterson quadrature for uniform parameters
+
+  @param npoints the number of points (1, 3, 7, 15, 31, ...)
+  @param a the lower bound
+  @param b the upper bound
+  @param z returns the points in standard domain
+  @param y returns the points in general domain
+  @param w returns the weights
+*/
+void NestedQuadrature::gaussPattersonQuadrature( int npoints,
+                                                 scalar a, scalar b,
+                                                 scalar *z, scalar *y, scalar *w ){
+  const int level = getLevel(GAUSS_PATTERSON, npoints);
+  if ( level < 0 ){
+    printf("Error: Invalid number of Gauss-Patterson quadrature points %d\n",
+           npoints);
+    return;
+  }
+  const double *zr, *wr;
+  getRule(GAUSS_PATTERSON, level, &zr, &wr);
+
+  // Return points in appropriate domains
+  for ( int n = 0; n < npoints; n++ ) {
+    z[n] = zr[n];
+    y[n] = a + (b-a)*zr[n];
+    w[n] = wr[n];
+  }
+}
+
+/**
+  Genz-Keister quadrature for normal parameters
+
+  @param npoints the number of points (1, 3, 9, 19, 35)
+  @param mu the mean
+  @param sigma the standard deviation
+  @param z returns the points in standard domain
+  @param y returns the points in general domain
+  @param w returns the weights
+*/
+void NestedQuadrature::genzKeisterQuadrature( int npoints,
+                                              scalar mu, scalar sigma,
+                                              scalar *z, scalar *y, scalar *w ){
+  const int level = getLevel(GENZ_KEISTER, npoints);
+  if ( level < 0 ){
+    printf("Error: Invalid number of Genz-Keister quadrature points %d\n",
+           npoints);
+    return;
+  }
+  const double *zr, *wr;
+  getRule(GENZ_KEISTER, level, &zr, &wr);
+
+  // Return points in appropriate domains
+  for ( int n = 0; n < npoints; n++ ) {
+    z[n] = zr[n];
+    y[n] = mu + sigma*zr[n];
+    w[n] = wr[n];
+  }
+}
@@ -28,9 +28,24 @@ NormalParameter::~NormalParameter(){}
   @param w array of weights for each point
 */
 void NormalParameter::quadrature(int npoints, scalar *z, scalar *y, scalar *w){
-  this->gauss->hermiteQuadrature(npoints,
-                                 this->mu, this->sigma,
-                                 z, y, w);
+  if (this->getQuadratureRule() == GENZ_KEISTER){
+    this->nested->genzKeisterQuadrature(npoints,
+                                        this->mu, this->sigma,
+                                        z, y, w);
+  } else {
+    this->gauss->hermiteQuadrature(npoints,
+                                   this->mu, this->sigma,
+                                   z, y, w);
+  }
+}
+
+/**
+  Normal parameters use Gauss-Hermite or nested Genz-Keister rules
+
+  @param rule the quadrature rule
+*/
+bool NormalParameter::hasQuadratureRule(int rule){
+  return rule == GAUSS || rule == GENZ_KEISTER;
 }
 
 /**
@@ -42,3 +57,30 @@ void NormalParameter::quadrature(int npoints, scalar *z, scalar *y, scalar *w){
 scalar NormalParameter::basis(scalar z, int d){
   return this->polyn->unit_hermite(z, d);
 }
+
+/**
+  Evaluate the basis of all orders 0..d at the point z as H(z,0..d)
+
+  @param z point to evaluate the basis function
+  @param d maximum degree of basis function
+  @param phi returns the basis values of each degree
+*/
+void NormalParameter::basis(scalar z, int d, scalar *phi){
+  this->polyn->unit_polynomials(OrthogonalPolynomials::HERMITE, z, d, phi);
+}
+
+/**
+  Evaluate the basis of all orders 0..d at an array of points as
+  H(z[p],k) stored in phi[k*ldphi + p]
+
+  @param npts number of points
+  @param z points to evaluate the basis function
+  @param d maximum degree of basis function
+  @param phi returns the basis values of each degree at each point
+  @param ldphi leading dimension of phi
+*/
+void NormalParameter::basis(int npts, const scalar *z, int d,
+                        scalar *phi, int ldphi){
+  this->polyn->unit_polynomials(OrthogonalPolynomials::HERMITE, npts, z, d,
+                                phi, ldphi);
+}
@@ -6,8 +6,10 @@
 
 #include <stdio.h>
 #include <math.h>
+#include <vector>
 
 #include "OrthogonalPolynomials.h"
+#include "VectorKernels.h"
 
 /**
    Constructor for orthogonal polynomials
@@ -40,7 +42,7 @@ scalar OrthogonalPolynomials::hermite(scalar z, int d){
    @param d the degree of basis function
 */
 scalar OrthogonalPolynomials::unit_hermite(scalar z, int d){
-  return hermite(z,d)/sqrt(factorial(d));
+  return unit_polynomial(HERMITE, z, d);
 }
 
 /**
@@ -64,7 +66,7 @@ scalar OrthogonalPolynomials::laguerre(scalar z, int d){
    @param d the degree of basis function
 */
 scalar OrthogonalPolynomials::unit_laguerre(scalar z, int d){
-  return laguerre(z,d);
+  return unit_polynomial(LAGUERRE, z, d);
 }
 
 /**
@@ -77,7 +79,7 @@ scalar OrthogonalPolynomials::legendre(scalar z, int d){
   if ( d <= 4 ) {
     return explicit_legendre(z,d);
   } else {
-    return general_legendre(z,d);
+    return recursive_legendre(z,d);
   }
 }
 
@@ -88,17 +90,121 @@ scalar OrthogonalPolynomials::legendre(scalar z, int d){
    @param d the degree of basis function
 */
 scalar OrthogonalPolynomials::unit_legendre(scalar z, int d){
-  return legendre(z,d)*sqrt(scalar(2*d+1));
+  return unit_polynomial(LEGENDRE, z, d);
 }
 
 /**
-   Combination nCr = n!/((n-r)!r!)
+   Recurrence coefficients of the orthonormal polynomials with respect
+   to the probability measure in standard domain
+
+   beta[k+1] phi[k+1](z) = (z - alpha[k]) phi[k](z) - beta[k] phi[k-1](z)
+
+   The sign of beta for Laguerre retains the (-1)^d leading
+   coefficient of the classical polynomials.
+
+   @param family the polynomial family
+   @param n the number of coefficients (k = 0..n-1)
+   @param alpha the diagonal coefficients
+   @param beta the off-diagonal coefficients (beta[0] = 0)
+*/
+void OrthogonalPolynomials::recurrence( int family, int n,
+                                        double *alpha, double *beta ){
+  for ( int k = 0; k < n; k++ ){
+    coefficients(family, k, &alpha[k], &beta[k]);
+  }
+}
+
+/**
+   Recurrence coefficients alpha[k] and beta[k] of a single degree,
+   see recurrence()
+
+   @param family the polynomial family
+   @param k the degree
+   @param alpha returns the diagonal coefficient
+   @param beta returns the off-diagonal coefficient
+*/
+void OrthogonalPolynomials::coefficients( int family, int k,
+                                          double *alpha, double *beta ){
+  if ( family == HERMITE ){
+    *alpha = 0.0;
+    *beta  = sqrt(double(k));
+  } else if ( family == LEGENDRE ){
+    *alpha = 0.5;
+    *beta  = (k > 0) ? 0.5*k/sqrt(4.0*k*k - 1.0) : 0.0;
+  } else {
+    *alpha = 2.0*k + 1.0;
+    *beta  = -double(k);
+  }
+}
+
+/**
+   Evaluate the orthonormal polynomial of degree d at a point with the
+   three-term recurrence, keeping only the last two degrees
+
+   @param family the polynomial family
+   @param z the point to evaluate the basis
+   @param d the degree of basis function
+*/
+scalar OrthogonalPolynomials::unit_polynomial( int family, scalar z, int d ){
+  double alpha, beta, alpha_next, beta_next;
+  scalar phi_prev = 0.0, phi = 1.0;
+  coefficients(family, 0, &alpha, &beta);
+  for ( int k = 0; k < d; k++ ){
+    coefficients(family, k+1, &alpha_next, &beta_next);
+    scalar phi_next = ((z - alpha)*phi - beta*phi_prev)/beta_next;
+    phi_prev = phi;
+    phi = phi_next;
+    alpha = alpha_next;
+    beta = beta_next;
+  }
+  return phi;
+}
+
+/**
+   Evaluate the orthonormal polynomials of degree 0..d at a point in
+   a single pass of the three-term recurrence
+
+   @param family the polynomial family
+   @param z the point to evaluate the basis
+   @param d the maximum degree of basis function
+   @param phi returns the values phi[0..d]
+*/
+void OrthogonalPolynomials::unit_polynomials( int family, scalar z, int d,
+                                              scalar *phi ){
+  double alpha, beta, alpha_next, beta_next;
+  coefficients(family, 0, &alpha, &beta);
+  phi[0] = 1.0;
+  for ( int k = 0; k < d; k++ ){
+    coefficients(family, k+1, &alpha_next, &beta_next);
+    phi[k+1] = (z - alpha)*phi[k];
+    if ( k > 0 ){
+      phi[k+1] -= beta*phi[k-1];
+    }
+    phi[k+1] /= beta_next;
+    alpha = alpha_next;
+    beta = beta_next;
+  }
+}
+
+/**
+   Evaluate the orthonormal polynomials of degree 0..d at an array of
+   points. The value of degree k at point p is stored in
+   phi[k*ldphi + p].
+
+   @param family the polynomial family
+   @param npts the number of points
+   @param z the points to evaluate the basis
+   @param d the maximum degree of basis function
+   @param phi returns the values of each degree at each point
+   @param ldphi the leading dimension of phi (at least npts)
 */
-scalar OrthogonalPolynomials::comb(int n, int r){
-  scalar nfact  = factorial(n);
-  scalar rfact  = factorial(r);
-  scalar nrfact = factorial(n-r);
-  return nfact/(rfact*nrfact);
+void OrthogonalPolynomials::unit_polynomials( int family, int npts,
+                                              const scalar *z, int d,
+                                              scalar *phi, int ldphi ){
+  std::vector<double> alpha(d+1), beta(d+1);
+  recurrence(family, d+1, alpha.data(), beta.data());
+  VectorKernels::recurrence(npts, z, d, alpha.data(), beta.data(),
+                            phi, ldphi);
 }
 
 /**
@@ -168,13 +274,11 @@ scalar OrthogonalPolynomials::explicit_hermite(scalar z, int d){
    @param d the degree of basis function
 */
 scalar OrthogonalPolynomials::recursive_hermite(scalar z, int d){
-  scalar hval = 0.0;
-  if ( d == 0 ) {
-    hval = 1.0;
-  } else if ( d == 1 ) {
-    hval = z;
-  } else {
-    hval = z*recursive_hermite(z,d-1) - scalar(d-1)*recursive_hermite(z,d-2);
+  scalar hm1 = 0.0, hval = 1.0;
+  for ( int k = 0; k < d; k++ ) {
+    scalar hp1 = z*hval - scalar(k)*hm1;
+    hm1 = hval;
+    hval = hp1;
   }
   return hval;
 }
@@ -211,14 +315,11 @@ scalar OrthogonalPolynomials::explicit_laguerre(scalar z, int d){
    @param d the degree of basis function
 */
 scalar OrthogonalPolynomials::recursive_laguerre(scalar z, int d){
-  scalar lval = 0.0;
-  if ( d == 0 ) {
-    lval = 1.0;
-  } else if ( d == 1 ) {
-    lval = 1.0 - z;
-  } else {
-    lval = ((scalar(2*d-1)-z)*recursive_laguerre(z,d-1) - scalar(d-1)*recursive_laguerre(z,d-2));
-    lval /= scalar(d);
+  scalar lm1 = 0.0, lval = 1.0;
+  for ( int k = 0; k < d; k++ ) {
+    scalar lp1 = ((scalar(2*k+1)-z)*lval - scalar(k)*lm1)/scalar(k+1);
+    lm1 = lval;
+    lval = lp1;
   }
   return lval;
 }
@@ -246,17 +347,18 @@ scalar OrthogonalPolynomials::explicit_legendre(scalar z, int d){
 }
 
 /**
-   Legendre polynomials are evaluated using general expressions
+   Legendre polynomials are evaluated using recursive expressions
 
    @param z the point to evaluate the basis
    @param d the degree of basis function
 */
-scalar OrthogonalPolynomials::general_legendre(scalar z, int d){
-  scalar pval = 0.0;
-  for (int k = 0; k <= d; k++){
-    pval = pval + comb(d,k)*comb(d+k,k)*pow(-z,k);
+scalar OrthogonalPolynomials::recursive_legendre(scalar z, int d){
+  scalar pm1 = 0.0, pval = 1.0;
+  for ( int k = 0; k < d; k++ ) {
+    scalar pp1 = (scalar(2*k+1)*(2.0*z - 1.0)*pval - scalar(k)*pm1)/scalar(k+1);
+    pm1 = pval;
+    pval = pp1;
   }
-  pval = pval*pow(-1.0,d);
   return pval;
 }
 
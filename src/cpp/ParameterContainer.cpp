@@ -1,4 +1,7 @@
 #include"ParameterContainer.h"
+#include"VectorKernels.h"
+
+#include<stdlib.h>
 
 using namespace std;
 
@@ -10,6 +13,22 @@ using namespace std;
 */
 ParameterContainer::ParameterContainer(int basis_type, int quadrature_type){
   this->tnum_parameters = 0;
+  this->tnum_basis_terms = 0;
+  this->tnum_quadrature_points = 0;
+  this->qnum_parameters = 0;
+  this->param_max_degree = NULL;
+  this->param_nqpts = NULL;
+  this->param_rule = NULL;
+  this->dindex = NULL;
+  this->Z = NULL;
+  this->Y = NULL;
+  this->W = NULL;
+  this->tensor_nqpts = NULL;
+  this->zp = this->yp = this->wp = NULL;
+  this->basis_table = NULL;
+  this->psi_kq = this->psi_qk = NULL;
+  this->wpsi_kq = this->wpsi_qk = NULL;
+  this->ldq = this->ldk = 0;
   bhelper = new BasisHelper(basis_type);
   qhelper = new QuadratureHelper(quadrature_type);
 }
@@ -23,20 +42,16 @@ ParameterContainer::~ParameterContainer(){
     delete [] param_max_degree;
   };
 
+  // Basis at quadrature points
+  deallocateBasisTable();
+
   // Degree of kth basis entry
-  for (int k = 0; k < this->getNumBasisTerms(); k++){
-    delete [] this->dindex[k];
-  };
-  delete [] this->dindex;
+  if (dindex){
+    delete [] this->dindex;
+  }
 
   // Deallocate quadrature information
-  for (int i = 0; i < this->getNumParameters(); i++){
-    delete [] Z[i];
-    delete [] Y[i];
-  }
-  delete [] Z;
-  delete [] Y;
-  delete [] W;
+  deallocateQuadrature();
 
   delete bhelper;
   delete qhelper;
@@ -48,9 +63,6 @@ ParameterContainer::~ParameterContainer(){
   @param param the probabilistic parameter
 */
 void ParameterContainer::addParameter(AbstractParameter *param){
-  if (this->tnum_parameters > 4){
-    printf("Warning: Parameter container is full\n");
-  }
   this->pmap.insert(std::pair<int, AbstractParameter*>(param->getParameterID(), param));
   this->tnum_parameters++;
 }
@@ -69,6 +81,15 @@ int ParameterContainer::getNumParameters(){
   return this->tnum_parameters;
 }
 
+/**
+   Returns the parameter with the given ID
+
+   @param pid the parameter ID
+*/
+AbstractParameter* ParameterContainer::getParameter(int pid){
+  return this->pmap[pid];
+}
+
 /**
    Returns the number of quadrature points
 */
@@ -84,23 +105,24 @@ int ParameterContainer::getNumQuadraturePoints(){
 void  ParameterContainer::initializeBasis(const int *pmax){
   int nvars = this->getNumParameters();
 
+  // The basis table depends on the basis set
+  deallocateBasisTable();
+
   // Copy over the max degrees
+  if (param_max_degree){
+    delete [] param_max_degree;
+  }
   param_max_degree = new int[nvars];
   for (int k = 0; k < nvars; k++){
     param_max_degree[k] = pmax[k];
   }
 
-  // Number of terms from tensor product
-  int nterms = 1;
-  for (int i = 0; i < nvars; i++){
-    nterms *= 1 + pmax[i];
-  }
-
-  // Allocate space for storing degree set
-  this->dindex = new int*[nterms];
-  for (int k = 0; k < nterms; k++){
-    this->dindex[k] = new int[nvars];
+  // Allocate space for storing degree set (nterms x nvars)
+  int nterms = this->bhelper->getNumBasisTerms(nvars, pmax);
+  if (dindex){
+    delete [] this->dindex;
   }
+  this->dindex = new int[nterms*nvars];
 
   // Generate and store a set of indices
   this->bhelper->basisDegrees(nvars, pmax,
@@ -115,52 +137,334 @@ void  ParameterContainer::initializeBasis(const int *pmax){
 */
 void ParameterContainer::initializeQuadrature(const int *nqpts){
   const int nvars = getNumParameters();
+
+  // The 1-D rules are cached, so the grid only needs to be rebuilt
+  // when the number of points or the rule of a parameter changes
+  if (param_nqpts && qnum_parameters == nvars){
+    bool same = true;
+    map<int,AbstractParameter*>::iterator it;
+    for (it = this->pmap.begin(); it != this->pmap.end(); it++){
+      int pid = it->first;
+      if (param_nqpts[pid] != nqpts[pid] ||
+          param_rule[pid] != it->second->getQuadratureRule()){
+        same = false;
+      }
+    }
+    if (same){
+      return;
+    }
+  }
+  deallocateQuadrature();
+  this->qnum_parameters = nvars;
+  param_nqpts = new int[nvars];
+  param_rule = new int[nvars];
+  map<int,AbstractParameter*>::iterator pit;
+  for (pit = this->pmap.begin(); pit != this->pmap.end(); pit++){
+    int pid = pit->first;
+    param_nqpts[pid] = nqpts[pid];
+    param_rule[pid] = pit->second->getQuadratureRule();
+  }
+
+  // Sparse grids draw the 1d rules of each size from the parameters
+  if (qhelper->getQuadratureType() == QuadratureHelper::SPARSE){
+    AbstractParameter **params = new AbstractParameter*[nvars];
+    map<int,AbstractParameter*>::iterator it;
+    for (it = this->pmap.begin(); it != this->pmap.end(); it++){
+      params[it->first] = it->second;
+    }
+    this->tnum_quadrature_points = qhelper->sparseGrid(nvars, nqpts, params,
+                                                       &Z, &Y, &W);
+    delete [] params;
+    return;
+  }
+
+  // Nested rules take the coarsest level as accurate as nqpts Gauss points
+  tensor_nqpts = new int[nvars];
+  map<int,AbstractParameter*>::iterator it;
+  for (it = this->pmap.begin(); it != this->pmap.end(); it++){
+    int pid = it->first;
+    int level = it->second->getQuadratureLevel(nqpts[pid]);
+    tensor_nqpts[pid] = it->second->getQuadratureSize(level);
+  }
+
   int totquadpts = 1;
   for (int i = 0; i < nvars; i++){
-    totquadpts *= nqpts[i];
+    totquadpts *= tensor_nqpts[i];
   }
   this->tnum_quadrature_points = totquadpts;
 
-  // Get the univariate quadrature points from parameters
-  scalar **y = new scalar*[nvars];
-  scalar **z = new scalar*[nvars];
-  scalar **w = new scalar*[nvars];
+  // Keep the univariate quadrature points from parameters; the tensor
+  // grid is generated from them on the fly
+  zp = new scalar*[nvars];
+  yp = new scalar*[nvars];
+  wp = new scalar*[nvars];
   for (int i = 0; i < nvars; i++){
-    z[i] = new scalar[nqpts[i]];
-    y[i] = new scalar[nqpts[i]];
-    w[i] = new scalar[nqpts[i]];
+    zp[i] = new scalar[tensor_nqpts[i]];
+    yp[i] = new scalar[tensor_nqpts[i]];
+    wp[i] = new scalar[tensor_nqpts[i]];
   }
-  map<int,AbstractParameter*>::iterator it;
   for (it = this->pmap.begin(); it != this->pmap.end(); it++){
     int pid = it->first;
-    it->second->quadrature(nqpts[pid], z[pid], y[pid], w[pid]);
+    it->second->quadrature(tensor_nqpts[pid], zp[pid], yp[pid], wp[pid]);
+  }
+}
+
+/**
+   Performs the initialization of quadrature from a downward closed set
+   of levels of the univariate rules, e.g. the grid chosen by
+   AdaptiveQuadrature. The tensor rules of the levels are combined as
+   in sparse grids.
+
+   @param nindices the number of level indices
+   @param levels the level of each parameter in each index (k*nvars+i)
+*/
+void ParameterContainer::initializeQuadrature(int nindices, const int *levels){
+  const int nvars = getNumParameters();
+  deallocateQuadrature();
+  this->qnum_parameters = nvars;
+
+  AbstractParameter **params = new AbstractParameter*[nvars];
+  map<int,AbstractParameter*>::iterator it;
+  for (it = this->pmap.begin(); it != this->pmap.end(); it++){
+    params[it->first] = it->second;
+  }
+  this->tnum_quadrature_points = qhelper->combinationRule(nvars, nindices,
+                                                          levels, params,
+                                                          &Z, &Y, &W);
+  delete [] params;
+}
+
+/**
+   Frees the multivariate quadrature points and weights, which were
+   allocated for the parameters present when the grid was built
+*/
+void ParameterContainer::deallocateQuadrature(){
+  deallocateBasisTable();
+  if (Z){
+    for (int i = 0; i < this->qnum_parameters; i++){
+      delete [] Z[i];
+      delete [] Y[i];
+    }
+    delete [] Z;
+    delete [] Y;
+    delete [] W;
   }
+  if (zp){
+    for (int i = 0; i < this->qnum_parameters; i++){
+      delete [] zp[i];
+      delete [] yp[i];
+      delete [] wp[i];
+    }
+    delete [] zp;
+    delete [] yp;
+    delete [] wp;
+    delete [] tensor_nqpts;
+  }
+  if (param_nqpts){
+    delete [] param_nqpts;
+    delete [] param_rule;
+  }
+  Z = NULL;
+  Y = NULL;
+  W = NULL;
+  zp = yp = wp = NULL;
+  tensor_nqpts = NULL;
+  param_nqpts = NULL;
+  param_rule = NULL;
+  qnum_parameters = 0;
+}
 
-  // Compute multivariate quadrature and store
-  Z = new scalar*[nvars];
-  Y = new scalar*[nvars];
-  W = new scalar[totquadpts];
+/**
+   Evaluates the basis functions at all quadrature points and stores
+   them in 64-byte aligned tables, termwise (psi_k at every point) and
+   pointwise (every psi_k at a point), along with copies scaled by the
+   quadrature weights. Rows are padded to a multiple of 8 entries.
+*/
+void ParameterContainer::initializeBasisTable(){
+  deallocateBasisTable();
+
+  const int nsterms = getNumBasisTerms();
+  const int nqpts = getNumQuadraturePoints();
+  ldq = 8*((nqpts + 7)/8);
+  ldk = 8*((nsterms + 7)/8);
+
+  size_t size = 2*(size_t(nsterms)*ldq + size_t(nqpts)*ldk);
+  void *ptr = NULL;
+  if (posix_memalign(&ptr, 64, size*sizeof(scalar)) != 0){
+    printf("Error: Unable to allocate basis table of size %zu\n", size);
+    return;
+  }
+  basis_table = (scalar*)ptr;
+  for (size_t i = 0; i < size; i++){
+    basis_table[i] = 0.0;
+  }
+  psi_kq  = basis_table;
+  wpsi_kq = &psi_kq[size_t(nsterms)*ldq];
+  psi_qk  = &wpsi_kq[size_t(nsterms)*ldq];
+  wpsi_qk = &psi_qk[size_t(nqpts)*ldk];
+
+  // Walk the quadrature points in chunks
+  const int nvars = getNumParameters();
+  const int nchunk = getQuadratureChunkSize();
+  scalar **zc = new scalar*[nvars];
+  scalar **yc = new scalar*[nvars];
+  scalar *wc = new scalar[nchunk];
   for (int i = 0; i < nvars; i++){
-    Z[i] = new scalar[totquadpts];
-    Y[i] = new scalar[totquadpts];
+    zc[i] = new scalar[nchunk];
+    yc[i] = new scalar[nchunk];
   }
 
-  // Find tensor product of 1d rules
-  qhelper->tensorProduct(nvars, nqpts, z, y, w, Z, Y, W);
+  for (int start = 0; start < nqpts; start += nchunk){
+    const int n = this->quadrature(start, nchunk, zc, yc, wc);
+    for (int k = 0; k < nsterms; k++){
+      scalar *row  = &psi_kq[size_t(k)*ldq + start];
+      scalar *wrow = &wpsi_kq[size_t(k)*ldq + start];
+      this->basis(k, n, zc, row);
+      for (int p = 0; p < n; p++){
+        const int q = start + p;
+        wrow[p] = row[p]*wc[p];
+        psi_qk[size_t(q)*ldk + k] = row[p];
+        wpsi_qk[size_t(q)*ldk + k] = wrow[p];
+      }
+    }
+  }
 
-  // Deallocate space
   for (int i = 0; i < nvars; i++){
-    delete [] z[i];
-    delete [] y[i];
-    delete [] w[i];
+    delete [] zc[i];
+    delete [] yc[i];
+  }
+  delete [] zc;
+  delete [] yc;
+  delete [] wc;
+}
+
+/**
+   Frees the tables of basis at quadrature points
+*/
+void ParameterContainer::deallocateBasisTable(){
+  if (basis_table){
+    free(basis_table);
+  }
+  basis_table = NULL;
+  psi_kq = psi_qk = NULL;
+  wpsi_kq = wpsi_qk = NULL;
+}
+
+/**
+   Returns the k-th basis function at all quadrature points. The table
+   is built on first access when it was not requested at
+   initialization.
+
+   @param k the basis function
+*/
+const scalar* ParameterContainer::getBasisRow(int k){
+  if (!basis_table){
+    initializeBasisTable();
+  }
+  return &psi_kq[size_t(k)*ldq];
+}
+
+/**
+   Returns all basis functions at the q-th quadrature point
+
+   @param q the quadrature point index
+*/
+const scalar* ParameterContainer::getBasisColumn(int q){
+  if (!basis_table){
+    initializeBasisTable();
   }
-  delete [] y;
-  delete [] z;
-  delete [] w;
+  return &psi_qk[size_t(q)*ldk];
 }
 
 /**
-  Returns the weight of quadrature point
+   Returns the k-th basis function at all quadrature points scaled by
+   the quadrature weights
+
+   @param k the basis function
+*/
+const scalar* ParameterContainer::getWeightedBasisRow(int k){
+  if (!basis_table){
+    initializeBasisTable();
+  }
+  return &wpsi_kq[size_t(k)*ldq];
+}
+
+/**
+   Returns all basis functions at the q-th quadrature point scaled by
+   its quadrature weight
+
+   @param q the quadrature point index
+*/
+const scalar* ParameterContainer::getWeightedBasisColumn(int q){
+  if (!basis_table){
+    initializeBasisTable();
+  }
+  return &wpsi_qk[size_t(q)*ldk];
+}
+
+/**
+   Returns the leading dimensions of the basis tables, so that a range
+   of rows or columns can be used as a matrix: getBasisRow(k)[q] is
+   entry k*ldq + q and getBasisColumn(q)[k] is entry q*ldk + k of the
+   termwise and pointwise tables
+
+   @param ldq returns the stride between basis terms (rows)
+   @param ldk returns the stride between quadrature points (columns)
+*/
+void ParameterContainer::getBasisTableStrides(int *_ldq, int *_ldk){
+  if (!basis_table){
+    initializeBasisTable();
+  }
+  *_ldq = this->ldq;
+  *_ldk = this->ldk;
+}
+
+/**
+   Returns the mean of a quantity from its projections c_k on the
+   basis terms. The basis is orthonormal with psi_0 = 1, so the mean
+   is the first coefficient c[0] for any stride.
+
+   @param c the projection on each basis term
+   @param inc the stride between the projections in c (unused)
+*/
+scalar ParameterContainer::getMean(const scalar *c, int inc){
+  (void)inc;
+  return c[0];
+}
+
+/**
+   Returns the variance of a quantity from its projections c_k on the
+   basis terms, sum_{k>0} c_k^2, in O(nterms) operations without
+   quadrature
+
+   @param c the projection on each basis term
+   @param inc the stride between the projections in c
+*/
+scalar ParameterContainer::getVariance(const scalar *c, int inc){
+  return getCovariance(c, c, inc);
+}
+
+/**
+   Returns the covariance of two quantities from their projections on
+   the basis terms, sum_{k>0} a_k b_k
+
+   @param a the projection of the first quantity on each basis term
+   @param b the projection of the second quantity on each basis term
+   @param inc the stride between the projections in a and b
+*/
+scalar ParameterContainer::getCovariance(const scalar *a, const scalar *b,
+                                         int inc){
+  const int nterms = getNumBasisTerms();
+  scalar cov = 0.0;
+  for (int k = 1; k < nterms; k++){
+    cov += a[k*inc]*b[k*inc];
+  }
+  return cov;
+}
+
+/**
+  Returns the weight of quadrature point. Points of tensor grids are
+  decoded from the mixed-radix digits of q (last parameter fastest).
 
   @param q the quadrature point index
   @param zq standard quadrature point
@@ -168,6 +472,17 @@ void ParameterContainer::initializeQuadrature(const int *nqpts){
 */
 scalar ParameterContainer::quadrature(int q, scalar *zq, scalar *yq){
   const int nvars = getNumParameters();
+  if (zp){
+    scalar wq = 1.0;
+    for (int i = nvars-1; i >= 0; i--){
+      const int j = q % tensor_nqpts[i];
+      q /= tensor_nqpts[i];
+      zq[i] = zp[i][j];
+      yq[i] = yp[i][j];
+      wq *= wp[i][j];
+    }
+    return wq;
+  }
   for (int i = 0; i < nvars; i++){
     zq[i] = this->Z[i][q];
     yq[i] = this->Y[i][q];
@@ -175,6 +490,76 @@ scalar ParameterContainer::quadrature(int q, scalar *zq, scalar *yq){
   return this->W[q];
 }
 
+/**
+  Returns a chunk of consecutive quadrature points and weights,
+  generated on the fly for tensor grids so that the whole grid is
+  never stored.
+
+  @param qstart index of the first quadrature point
+  @param npts maximum number of points in the chunk
+  @param zq standard quadrature points (zq[i][p])
+  @param yq general quadrature points (yq[i][p])
+  @param wq quadrature weights
+  @return the number of points in the chunk
+*/
+int ParameterContainer::quadrature(int qstart, int npts,
+                                   scalar **zq, scalar **yq, scalar *wq){
+  const int nvars = getNumParameters();
+  if (qstart + npts > getNumQuadraturePoints()){
+    npts = getNumQuadraturePoints() - qstart;
+  }
+  if (npts <= 0){
+    return 0;
+  }
+  if (zp){
+    qhelper->tensorProduct(nvars, tensor_nqpts, zp, yp, wp,
+                           qstart, npts, zq, yq, wq);
+    return npts;
+  }
+  for (int p = 0; p < npts; p++){
+    for (int i = 0; i < nvars; i++){
+      zq[i][p] = this->Z[i][qstart+p];
+      yq[i][p] = this->Y[i][qstart+p];
+    }
+    wq[p] = this->W[qstart+p];
+  }
+  return npts;
+}
+
+/**
+  Returns the univariate rule of a parameter that generates the tensor
+  grid, or zero points when the grid is not a tensor product
+
+  @param pid the parameter ID
+  @param npts returns the number of points of the rule
+  @param z returns the points in standard domain
+  @param w returns the weights
+*/
+void ParameterContainer::getTensorQuadrature(int pid, int *npts,
+                                             const scalar **z,
+                                             const scalar **w){
+  if (!zp){
+    *npts = 0;
+    *z = *w = NULL;
+    return;
+  }
+  *npts = tensor_nqpts[pid];
+  *z = zp[pid];
+  *w = wp[pid];
+}
+
+/**
+  Returns the number of quadrature points per chunk so that the
+  points and weights of a chunk (2*nvars+1 values each) stay within
+  32 KB of cache
+*/
+int ParameterContainer::getQuadratureChunkSize(){
+  const int nvars = getNumParameters();
+  int nchunk = 32768/(int(sizeof(scalar))*(2*nvars + 1));
+  nchunk = 8*(nchunk/8);
+  return (nchunk < 8) ? 8 : nchunk;
+}
+
 /**
   Evaluate the k-the basis function at point "z"
 
@@ -182,15 +567,57 @@ scalar ParameterContainer::quadrature(int q, scalar *zq, scalar *yq){
   @param z the multivariate quadrature location
 */
 scalar ParameterContainer::basis(int k, scalar *z){
+  const int nvars = getNumParameters();
   scalar psi = 1.0;
   map<int,AbstractParameter*>::iterator it;
   for (it = this->pmap.begin(); it != this->pmap.end(); it++){
     int pid = it->first;
-    psi *= it->second->basis(z[pid], this->dindex[k][pid]);
+    psi *= it->second->basis(z[pid], this->dindex[k*nvars+pid]);
   }
   return psi;
 }
 
+/**
+  Evaluate the k-the basis function at a batch of points. The
+  univariate polynomials of each parameter are evaluated across the
+  points in chunks and multiplied into psi with vector kernels.
+
+  @param k the basis function
+  @param npts the number of points
+  @param z the points of each parameter (z[pid][p])
+  @param psi returns the basis function value at each point
+*/
+void ParameterContainer::basis(int k, int npts, scalar **z, scalar *psi){
+  const int nchunk = 256;
+  const int nvars = getNumParameters();
+  int dmax = 0;
+  map<int,AbstractParameter*>::iterator it;
+  for (it = this->pmap.begin(); it != this->pmap.end(); it++){
+    int pid = it->first;
+    if (this->dindex[k*nvars+pid] > dmax){
+      dmax = this->dindex[k*nvars+pid];
+    }
+  }
+  scalar *phi = new scalar[(dmax+1)*nchunk];
+
+  for (int start = 0; start < npts; start += nchunk){
+    const int n = (npts - start < nchunk) ? npts - start : nchunk;
+    for (int p = 0; p < n; p++){
+      psi[start+p] = 1.0;
+    }
+    for (it = this->pmap.begin(); it != this->pmap.end(); it++){
+      int pid = it->first;
+      int d = this->dindex[k*nvars+pid];
+      if (d > 0){
+        it->second->basis(n, &z[pid][start], d, phi, nchunk);
+        VectorKernels::multiply(n, &phi[d*nchunk], &psi[start]);
+      }
+    }
+  }
+
+  delete [] phi;
+}
+
 /**
    Gets the basis parameter degrees
 
@@ -200,7 +627,7 @@ scalar ParameterContainer::basis(int k, scalar *z){
 void ParameterContainer::getBasisParamDeg(int k, int *degs) {
   const int nvars = getNumParameters();
   for (int i = 0; i < nvars; i++){
-    degs[i] = this->dindex[k][i];
+    degs[i] = this->dindex[k*nvars+i];
   }
 }
 
@@ -220,8 +647,10 @@ void ParameterContainer::getBasisParamMaxDeg(int *pmax) {
 
 /**
   Default initialization
+
+  @param build_basis_table precompute the basis at quadrature points
 */
-void ParameterContainer::initialize(){
+void ParameterContainer::initialize(bool build_basis_table){
   const int nvars = getNumParameters();
   int nqpts[nvars];
   int pmax[nvars];
@@ -234,4 +663,7 @@ void ParameterContainer::initialize(){
   }
   this->initializeBasis(pmax);
   this->initializeQuadrature(nqpts);
+  if (build_basis_table){
+    this->initializeBasisTable();
+  }
 }
@@ -1,4 +1,7 @@
 #include <stdio.h>
+#include <math.h>
+#include <map>
+#include <vector>
 #include"QuadratureHelper.h"
 
 #include"NormalParameter.h"
@@ -20,7 +23,100 @@ QuadratureHelper::QuadratureHelper(int _quadrature_type){
 QuadratureHelper::~QuadratureHelper(){}
 
 /**
-   Function that performs tensor product of univariate rules
+   Returns the multivariate quadrature type (tensor=0/sparse=1)
+ */
+int QuadratureHelper::getQuadratureType(){
+  return this->quadrature_type;
+}
+
+namespace{
+  /*
+    Univariate rules of a parameter at levels 1, 2, ... Nodes that
+    coincide across rules (e.g. the center of symmetric rules) share
+    one node id so that the multivariate points can be merged.
+  */
+  class RuleSet {
+  public:
+    RuleSet( AbstractParameter *_param ){
+      param = _param;
+    }
+
+    // Make the rules up to the given level available
+    void addRule( int level ){
+      while ((int)ids.size() < level){
+        int m = param->getQuadratureSize(ids.size() + 1);
+        std::vector<scalar> z(m), y(m), w(m);
+        param->quadrature(m, z.data(), y.data(), w.data());
+        std::vector<int> rid(m);
+        for (int j = 0; j < m; j++){
+          rid[j] = findNode(z[j], y[j]);
+        }
+        ids.push_back(rid);
+        wts.push_back(w);
+      }
+    }
+
+    AbstractParameter *param;
+    std::vector<scalar> znodes, ynodes;  // distinct nodes
+    std::vector< std::vector<int> > ids; // node ids of the rule at each level
+    std::vector< std::vector<scalar> > wts; // weights of the rule at each level
+
+  private:
+    int findNode( scalar z, scalar y ){
+      const double zr = RealPart(z);
+      for (size_t j = 0; j < znodes.size(); j++){
+        if (fabs(RealPart(znodes[j]) - zr) <= 1.0e-12*(1.0 + fabs(zr))){
+          return j;
+        }
+      }
+      znodes.push_back(z);
+      ynodes.push_back(y);
+      return znodes.size() - 1;
+    }
+  };
+
+  /*
+    Append the level indices whose rules first integrate degrees
+    adding up to at most the budget, varying the variables from i on
+  */
+  void addLevels( const int nvars, int i, int budget,
+                  const std::vector< std::vector<int> > &dlow,
+                  std::vector<int> &index, std::vector<int> &levels ){
+    if (i == nvars){
+      levels.insert(levels.end(), index.begin(), index.end());
+      return;
+    }
+    for (int l = 1; l <= (int)dlow[i].size() && dlow[i][l-1] <= budget; l++){
+      index[i] = l;
+      addLevels(nvars, i+1, budget - dlow[i][l-1], dlow, index, levels);
+    }
+    index[i] = 1;
+  }
+
+  /*
+    Combination coefficient of a level index: the sum of (-1)^|e| over
+    the binary offsets e for which index+e is in the set. The offsets
+    are explored depth first, which is enough for downward closed sets
+    since a missing index rules out all of its successors.
+  */
+  int combinationCoefficient( const int nvars,
+                              std::vector<int> &index, int start,
+                              const std::map<std::vector<int>, int> &iset ){
+    int coeff = 0;
+    for (int i = start; i < nvars; i++){
+      index[i]++;
+      if (iset.count(index)){
+        coeff -= 1 + combinationCoefficient(nvars, index, i+1, iset);
+      }
+      index[i]--;
+    }
+    return coeff;
+  }
+}
+
+/**
+   Function that performs tensor product of univariate rules for any
+   number of variables
 
    @param nvars number of variables
    @param nqpts number of quadrature points for each variable
@@ -35,100 +131,211 @@ void QuadratureHelper::tensorProduct( const int nvars,
                                       const int *nqpts,
                                       scalar **zp, scalar **yp, scalar **wp,
                                       scalar **zz, scalar **yy, scalar *ww ){
+  int npoints = 1;
+  for (int i = 0; i < nvars; i++){
+    npoints *= nqpts[i];
+  }
+  tensorProduct(nvars, nqpts, zp, yp, wp, 0, npoints, zz, yy, ww);
+}
 
+/**
+   Function that forms a chunk of consecutive points of the tensor
+   product of univariate rules without forming the whole grid. The
+   first point is decoded from its mixed-radix digits (last variable
+   fastest) and the rest follow by incrementing the digits.
 
-  if (nvars == 1) {
+   @param nvars number of variables
+   @param nqpts number of quadrature points for each variable
+   @param zp quadrature point in standardized probabilistic domain
+   @param yp quadrature point in general probabilistic domain
+   @param wp weights for each quadrature point
+   @param qstart index of the first point of the chunk
+   @param npoints number of points in the chunk
+   @param zz chunk of quadrature points in standard domain (zz[i][p])
+   @param yy chunk of quadrature points in general domain (yy[i][p])
+   @param ww chunk of quadrature weights
+ */
+void QuadratureHelper::tensorProduct( const int nvars,
+                                      const int *nqpts,
+                                      scalar **zp, scalar **yp, scalar **wp,
+                                      int qstart, int npoints,
+                                      scalar **zz, scalar **yy, scalar *ww ){
+  // Mixed-radix digits of the first point
+  int *idx = new int[nvars];
+  int q = qstart;
+  for (int i = nvars-1; i >= 0; i--){
+    idx[i] = q % nqpts[i];
+    q /= nqpts[i];
+  }
 
-    int ctr = 0;
-    for (int ii = 0; ii < nqpts[0]; ii++){
-      zz[0][ctr] = zp[0][ii];
-      yy[0][ctr] = yp[0][ii];
-      ww[ctr] = wp[0][ii];
-      ctr++;
+  for (int ctr = 0; ctr < npoints; ctr++){
+    scalar wt = 1.0;
+    for (int i = 0; i < nvars; i++){
+      zz[i][ctr] = zp[i][idx[i]];
+      yy[i][ctr] = yp[i][idx[i]];
+      wt *= wp[i][idx[i]];
     }
+    ww[ctr] = wt;
 
-  } else if (nvars == 2) {
-
-    int ctr = 0;
-    for (int ii = 0; ii < nqpts[0]; ii++){
-      for (int jj = 0; jj < nqpts[1]; jj++){
-        zz[0][ctr] = zp[0][ii];
-        yy[0][ctr] = yp[0][ii];
-        zz[1][ctr] = zp[1][jj];
-        yy[1][ctr] = yp[1][jj];
-        ww[ctr] = wp[0][ii]*wp[1][jj];
-        ctr++;
+    for (int i = nvars-1; i >= 0; i--){
+      if (++idx[i] < nqpts[i]){
+        break;
       }
+      idx[i] = 0;
+    }
+  }
+
+  delete [] idx;
+}
+
+/**
+   Function that forms a Smolyak sparse grid. The grid combines tensor
+   products of the rules of each parameter at levels l_i, up to the
+   level as accurate as the Gauss rule with nqpts[i] points. A level
+   enters when the degrees first integrated exactly by its rules, d(l_i)
+   = degree(l_i - 1) + 1, add up to at most 2*max(nqpts) - 1, so that
+   the grid integrates the products of polynomials of that total degree
+   exactly. For Gauss rules this is sum(l_i - 1) <= max(nqpts) - 1.
+   Nested rules share their points across levels, which reduces the
+   grid further.
+
+   The points, weights and their arrays (nvars x npoints) are
+   allocated here and owned by the caller.
+
+   @param nvars number of variables
+   @param nqpts maximum number of quadrature points for each variable
+   @param params the parameter of each variable
+   @param zz returns multivariate quadrature points in standard domain
+   @param yy returns multivariate quadrature points in general domain
+   @param ww returns multivariate quadrature weights
+   @return the number of multivariate quadrature points
+ */
+int QuadratureHelper::sparseGrid( const int nvars,
+                                  const int *nqpts,
+                                  AbstractParameter **params,
+                                  scalar ***zz, scalar ***yy, scalar **ww ){
+  // Degree first integrated exactly at each level of each rule
+  std::vector< std::vector<int> > dlow(nvars);
+  int dmax = 0;
+  for (int i = 0; i < nvars; i++){
+    const int lmax = params[i]->getQuadratureLevel(nqpts[i]);
+    dlow[i].resize(lmax);
+    dlow[i][0] = 0;
+    for (int l = 2; l <= lmax; l++){
+      dlow[i][l-1] = params[i]->getQuadratureDegree(l-1) + 1;
+    }
+    if (2*nqpts[i] - 1 > dmax){
+      dmax = 2*nqpts[i] - 1;
     }
+  }
 
-  } else if (nvars == 3) {
-
-    int ctr = 0;
-    for (int ii = 0; ii < nqpts[0]; ii++){
-      for (int jj = 0; jj < nqpts[1]; jj++){
-        for (int kk = 0; kk < nqpts[2]; kk++){
-          zz[0][ctr] = zp[0][ii];
-          yy[0][ctr] = yp[0][ii];
-          zz[1][ctr] = zp[1][jj];
-          yy[1][ctr] = yp[1][jj];
-          zz[2][ctr] = zp[2][kk];
-          yy[2][ctr] = yp[2][kk];
-          ww[ctr] = wp[0][ii]*wp[1][jj]*wp[2][kk];
-          ctr++;
-        }
-      }
+  std::vector<int> index(nvars, 1), levels;
+  addLevels(nvars, 0, dmax, dlow, index, levels);
+  const int nindices = levels.size()/nvars;
+
+  return combinationRule(nvars, nindices, levels.data(), params, zz, yy, ww);
+}
+
+/**
+   Function that combines tensor products of univariate rules over a
+   downward closed set of levels (the level of refinement of the rule
+   of each parameter). Each tensor rule enters with its combination
+   coefficient, points shared between rules are merged and their
+   signed weights summed. Points whose weights cancel are dropped.
+
+   The points, weights and their arrays (nvars x npoints) are
+   allocated here and owned by the caller.
+
+   @param nvars number of variables
+   @param nindices number of level indices
+   @param levels the level indices (levels[k*nvars + i] >= 1)
+   @param params the parameter of each variable
+   @param zz returns multivariate quadrature points in standard domain
+   @param yy returns multivariate quadrature points in general domain
+   @param ww returns multivariate quadrature weights
+   @return the number of multivariate quadrature points
+ */
+int QuadratureHelper::combinationRule( const int nvars,
+                                       const int nindices,
+                                       const int *levels,
+                                       AbstractParameter **params,
+                                       scalar ***zz, scalar ***yy, scalar **ww ){
+  std::vector<RuleSet> rules;
+  for (int i = 0; i < nvars; i++){
+    rules.push_back(RuleSet(params[i]));
+  }
+
+  std::map<std::vector<int>, int> iset;
+  for (int k = 0; k < nindices; k++){
+    std::vector<int> index(&levels[k*nvars], &levels[(k+1)*nvars]);
+    iset[index] = k;
+  }
+
+  // Accumulate the weights of the merged points, keyed by node ids
+  std::map<std::vector<int>, scalar> points;
+  std::vector<int> idx(nvars), node(nvars), size(nvars);
+  std::map<std::vector<int>, int>::const_iterator it;
+  for (it = iset.begin(); it != iset.end(); it++){
+    std::vector<int> index = it->first;
+    int coeff = 1 + combinationCoefficient(nvars, index, 0, iset);
+    if (coeff == 0){
+      continue;
     }
 
+    int ntensor = 1;
+    for (int i = 0; i < nvars; i++){
+      rules[i].addRule(index[i]);
+      size[i] = rules[i].ids[index[i]-1].size();
+      ntensor *= size[i];
+      idx[i] = 0;
+    }
 
-  } else if (nvars == 4) {
-
-    int ctr = 0;
-    for (int ii = 0; ii < nqpts[0]; ii++){
-      for (int jj = 0; jj < nqpts[1]; jj++){
-        for (int kk = 0; kk < nqpts[2]; kk++){
-          for (int ll = 0; ll < nqpts[3]; ll++){
-            zz[0][ctr] = zp[0][ii];
-            yy[0][ctr] = yp[0][ii];
-            zz[1][ctr] = zp[1][jj];
-            yy[1][ctr] = yp[1][jj];
-            zz[2][ctr] = zp[2][kk];
-            yy[2][ctr] = yp[2][kk];
-            zz[3][ctr] = zp[3][ll];
-            yy[3][ctr] = yp[3][ll];
-            ww[ctr] = wp[0][ii]*wp[1][jj]*wp[2][kk]*wp[3][ll];
-            ctr++;
-          }
-        }
+    for (int ctr = 0; ctr < ntensor; ctr++){
+      scalar wt = coeff;
+      for (int i = 0; i < nvars; i++){
+        node[i] = rules[i].ids[index[i]-1][idx[i]];
+        wt *= rules[i].wts[index[i]-1][idx[i]];
       }
-    }
+      points[node] += wt;
 
-  } else if (nvars == 5) {
-
-    int ctr = 0;
-    for (int ii = 0; ii < nqpts[0]; ii++){
-      for (int jj = 0; jj < nqpts[1]; jj++){
-        for (int kk = 0; kk < nqpts[2]; kk++){
-          for (int ll = 0; ll < nqpts[3]; ll++){
-            for (int mm = 0; mm < nqpts[4]; mm++){
-              zz[0][ctr] = zp[0][ii];
-              yy[0][ctr] = yp[0][ii];
-              zz[1][ctr] = zp[1][jj];
-              yy[1][ctr] = yp[1][jj];
-              zz[2][ctr] = zp[2][kk];
-              yy[2][ctr] = yp[2][kk];
-              zz[3][ctr] = zp[3][ll];
-              yy[3][ctr] = yp[3][ll];
-              zz[4][ctr] = zp[4][mm];
-              yy[4][ctr] = yp[4][mm];
-              ww[ctr] = wp[0][ii]*wp[1][jj]*wp[2][kk]*wp[3][ll]*wp[4][mm];
-              ctr++;
-            }
-          }
+      for (int i = nvars-1; i >= 0; i--){
+        if (++idx[i] < size[i]){
+          break;
         }
+        idx[i] = 0;
       }
     }
+  }
+
+  // Drop the points whose signed weights cancel
+  std::map<std::vector<int>, scalar>::iterator pt;
+  for (pt = points.begin(); pt != points.end(); ){
+    if (fabs(RealPart(pt->second)) < 1.0e-14){
+      points.erase(pt++);
+    } else {
+      pt++;
+    }
+  }
+
+  int npoints = points.size();
+  zz[0] = new scalar*[nvars];
+  yy[0] = new scalar*[nvars];
+  ww[0] = new scalar[npoints];
+  for (int i = 0; i < nvars; i++){
+    zz[0][i] = new scalar[npoints];
+    yy[0][i] = new scalar[npoints];
+  }
+
+  int q = 0;
+  for (pt = points.begin(); pt != points.end(); pt++, q++){
+    for (int i = 0; i < nvars; i++){
+      zz[0][i][q] = rules[i].znodes[pt->first[i]];
+      yy[0][i][q] = rules[i].ynodes[pt->first[i]];
+    }
+    ww[0][q] = pt->second;
+  }
 
-  } // end if
+  return npoints;
 }
 
 /**
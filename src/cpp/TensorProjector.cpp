@@ -0,0 +1,240 @@
+#include "TensorProjector.h"
+
+/**
+   Constructor for the projector. Builds the univariate tables from the
+   tensor rules and the basis of the initialized container.
+
+   @param pc the parameter container with tensor quadrature
+*/
+TensorProjector::TensorProjector( ParameterContainer *_pc ){
+  this->pc = _pc;
+  this->nvars = pc->getNumParameters();
+  this->nsterms = pc->getNumBasisTerms();
+  this->nqpts = pc->getNumQuadraturePoints();
+  this->npts = new int[nvars];
+  this->ndeg = new int[nvars];
+  this->offset = new int[nsterms];
+  this->phi = new scalar*[nvars];
+  this->wphi = new scalar*[nvars];
+
+  // Number of degrees of each parameter in the basis set
+  int *degs = new int[nvars];
+  for (int i = 0; i < nvars; i++){
+    ndeg[i] = 1;
+  }
+  for (int k = 0; k < nsterms; k++){
+    pc->getBasisParamDeg(k, degs);
+    for (int i = 0; i < nvars; i++){
+      if (degs[i] + 1 > ndeg[i]){
+        ndeg[i] = degs[i] + 1;
+      }
+    }
+  }
+
+  // Position of each basis term in the coefficient tensor
+  for (int k = 0; k < nsterms; k++){
+    pc->getBasisParamDeg(k, degs);
+    offset[k] = 0;
+    for (int i = 0; i < nvars; i++){
+      offset[k] = offset[k]*ndeg[i] + degs[i];
+    }
+  }
+  delete [] degs;
+
+  // Univariate basis at the points of each tensor rule
+  for (int i = 0; i < nvars; i++){
+    const scalar *z, *w;
+    pc->getTensorQuadrature(i, &npts[i], &z, &w);
+    if (npts[i] <= 0){
+      printf("Error: Tensor projection requires tensor product quadrature\n");
+      phi[i] = wphi[i] = NULL;
+      continue;
+    }
+    const int n = npts[i];
+    phi[i] = new scalar[ndeg[i]*n];
+    wphi[i] = new scalar[ndeg[i]*n];
+    pc->getParameter(i)->basis(n, z, ndeg[i]-1, phi[i], n);
+    for (int a = 0; a < ndeg[i]; a++){
+      for (int j = 0; j < n; j++){
+        wphi[i][a*n + j] = w[j]*phi[i][a*n + j];
+      }
+    }
+  }
+
+  // Largest intermediate tensor of the forward and reverse sweeps
+  max_size = 1;
+  for (int i = 0; i < nvars; i++){
+    int fwd = 1, rev = 1;
+    for (int l = 0; l < nvars; l++){
+      fwd *= (l < i) ? npts[l] : ndeg[l];
+      rev *= (l <= i) ? npts[l] : ndeg[l];
+    }
+    if (fwd > max_size){ max_size = fwd; }
+    if (rev > max_size){ max_size = rev; }
+  }
+  if (nqpts > max_size){
+    max_size = nqpts;
+  }
+}
+
+/**
+   Destructor
+*/
+TensorProjector::~TensorProjector(){
+  for (int i = 0; i < nvars; i++){
+    if (phi[i]){ delete [] phi[i]; }
+    if (wphi[i]){ delete [] wphi[i]; }
+  }
+  delete [] phi;
+  delete [] wphi;
+  delete [] npts;
+  delete [] ndeg;
+  delete [] offset;
+}
+
+/**
+   Applies a univariate table along the middle axis of a tensor of
+   shape (outer, nin, inner)
+
+     out(o, a, t) = sum_j A(a, j) in(o, j, t)
+
+   or with the transpose of A.
+
+   @param outer the size of the leading axes
+   @param nin the size of the contracted axis
+   @param nout the size of the resulting axis
+   @param inner the size of the trailing axes
+   @param A the table
+   @param lda the leading dimension of A
+   @param transpose use A(j, a) instead of A(a, j)
+   @param in the input tensor
+   @param out the output tensor
+*/
+void TensorProjector::contract( int outer, int nin, int nout, int inner,
+                                const scalar *A, int lda, int transpose,
+                                const scalar *in, scalar *out ){
+  for (int o = 0; o < outer; o++){
+    const scalar *src = &in[size_t(o)*nin*inner];
+    for (int a = 0; a < nout; a++){
+      scalar *dst = &out[(size_t(o)*nout + a)*inner];
+      for (int t = 0; t < inner; t++){
+        dst[t] = 0.0;
+      }
+      for (int j = 0; j < nin; j++){
+        const scalar c = transpose ? A[j*lda + a] : A[a*lda + j];
+        const scalar *row = &src[size_t(j)*inner];
+        for (int t = 0; t < inner; t++){
+          dst[t] += c*row[t];
+        }
+      }
+    }
+  }
+}
+
+/**
+   Projects values at the quadrature points onto the basis
+
+     fk(k) = sum_q w_q psi_k(z_q) fq(q)
+
+   @param ndata the number of quantities
+   @param fq the values at quadrature points (nqpts x ndata)
+   @param fk returns the coefficients (nsterms x ndata)
+*/
+void TensorProjector::project( int ndata, const scalar *fq, scalar *fk ){
+  for (int i = 0; i < nvars; i++){
+    if (!phi[i]){
+      printf("Error: Tensor projection requires tensor product quadrature\n");
+      return;
+    }
+  }
+
+  scalar *work[2];
+  work[0] = new scalar[size_t(max_size)*ndata];
+  work[1] = new scalar[size_t(max_size)*ndata];
+
+  // Contract the axes from the fastest varying one
+  const scalar *in = fq;
+  int cur = 0;
+  for (int i = nvars-1; i >= 0; i--){
+    int outer = 1, inner = ndata;
+    for (int l = 0; l < i; l++){
+      outer *= npts[l];
+    }
+    for (int l = i+1; l < nvars; l++){
+      inner *= ndeg[l];
+    }
+    contract(outer, npts[i], ndeg[i], inner, wphi[i], npts[i], 0,
+             in, work[cur]);
+    in = work[cur];
+    cur = 1 - cur;
+  }
+
+  // Gather the coefficients of the basis terms
+  for (int k = 0; k < nsterms; k++){
+    const scalar *src = &in[size_t(offset[k])*ndata];
+    for (int m = 0; m < ndata; m++){
+      fk[size_t(k)*ndata + m] = src[m];
+    }
+  }
+
+  delete [] work[0];
+  delete [] work[1];
+}
+
+/**
+   Reconstructs values at the quadrature points from the coefficients
+
+     fq(q) = sum_k psi_k(z_q) fk(k)
+
+   @param ndata the number of quantities
+   @param fk the coefficients (nsterms x ndata)
+   @param fq returns the values at quadrature points (nqpts x ndata)
+*/
+void TensorProjector::reconstruct( int ndata, const scalar *fk, scalar *fq ){
+  for (int i = 0; i < nvars; i++){
+    if (!phi[i]){
+      printf("Error: Tensor projection requires tensor product quadrature\n");
+      return;
+    }
+  }
+
+  scalar *work[2];
+  work[0] = new scalar[size_t(max_size)*ndata];
+  work[1] = new scalar[size_t(max_size)*ndata];
+
+  // Scatter the coefficients into the coefficient tensor
+  int ncoeff = 1;
+  for (int i = 0; i < nvars; i++){
+    ncoeff *= ndeg[i];
+  }
+  for (size_t e = 0; e < size_t(ncoeff)*ndata; e++){
+    work[0][e] = 0.0;
+  }
+  for (int k = 0; k < nsterms; k++){
+    scalar *dst = &work[0][size_t(offset[k])*ndata];
+    for (int m = 0; m < ndata; m++){
+      dst[m] = fk[size_t(k)*ndata + m];
+    }
+  }
+
+  // Expand the axes back to the points, writing the last into fq
+  const scalar *in = work[0];
+  int cur = 1;
+  for (int i = 0; i < nvars; i++){
+    int outer = 1, inner = ndata;
+    for (int l = 0; l < i; l++){
+      outer *= npts[l];
+    }
+    for (int l = i+1; l < nvars; l++){
+      inner *= ndeg[l];
+    }
+    scalar *out = (i == nvars-1) ? fq : work[cur];
+    contract(outer, ndeg[i], npts[i], inner, phi[i], npts[i], 1,
+             in, out);
+    in = out;
+    cur = 1 - cur;
+  }
+
+  delete [] work[0];
+  delete [] work[1];
+}
@@ -28,9 +28,29 @@ UniformParameter::~UniformParameter(){}
   @param w array of weights for each point
 */
 void UniformParameter::quadrature(int npoints, scalar *z, scalar *y, scalar *w){
-  this->gauss->legendreQuadrature(npoints,
-                                  this->a, this->b,
-                                  z, y, w);
+  if (this->getQuadratureRule() == CLENSHAW_CURTIS){
+    this->nested->clenshawCurtisQuadrature(npoints,
+                                           this->a, this->b,
+                                           z, y, w);
+  } else if (this->getQuadratureRule() == GAUSS_PATTERSON){
+    this->nested->gaussPattersonQuadrature(npoints,
+                                           this->a, this->b,
+                                           z, y, w);
+  } else {
+    this->gauss->legendreQuadrature(npoints,
+                                    this->a, this->b,
+                                    z, y, w);
+  }
+}
+
+/**
+  Uniform parameters use Gauss-Legendre or nested Clenshaw-Curtis and
+  Gauss-Patterson rules
+
+  @param rule the quadrature rule
+*/
+bool UniformParameter::hasQuadratureRule(int rule){
+  return rule == GAUSS || rule == CLENSHAW_CURTIS || rule == GAUSS_PATTERSON;
 }
 
 /**
@@ -42,3 +62,30 @@ void UniformParameter::quadrature(int npoints, scalar *z, scalar *y, scalar *w){
 scalar UniformParameter::basis(scalar z, int d){
   return this->polyn->unit_legendre(z, d);
 }
+
+/**
+  Evaluate the basis of all orders 0..d at the point z as P(z,0..d)
+
+  @param z point to evaluate the basis function
+  @param d maximum degree of basis function
+  @param phi returns the basis values of each degree
+*/
+void UniformParameter::basis(scalar z, int d, scalar *phi){
+  this->polyn->unit_polynomials(OrthogonalPolynomials::LEGENDRE, z, d, phi);
+}
+
+/**
+  Evaluate the basis of all orders 0..d at an array of points as
+  P(z[p],k) stored in phi[k*ldphi + p]
+
+  @param npts number of points
+  @param z points to evaluate the basis function
+  @param d maximum degree of basis function
+  @param phi returns the basis values of each degree at each point
+  @param ldphi leading dimension of phi
+*/
+void UniformParameter::basis(int npts, const scalar *z, int d,
+                        scalar *phi, int ldphi){
+  this->polyn->unit_polynomials(OrthogonalPolynomials::LEGENDRE, npts, z, d,
+                                phi, ldphi);
+}
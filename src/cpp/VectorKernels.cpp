@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <vector>
+#include "VectorKernels.h"
+
+// Vector instruction sets are only used for real builds on x86
+#if !defined(USE_COMPLEX) && defined(__GNUC__) && defined(__x86_64__)
+#define PSPACE_VECTOR_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace{
+  /*
+    Portable recurrence across points. The vector kernels follow the
+    same sequence of operations, so the instruction sets agree up to
+    rounding.
+  */
+  void recurrenceGeneric( int npts, const scalar *z, int d,
+                          const double *alpha, const double *beta,
+                          scalar *phi, int ldphi ){
+    for ( int p = 0; p < npts; p++ ){
+      phi[p] = 1.0;
+    }
+    if ( d > 0 ){
+      const double rb = 1.0/beta[1];
+      for ( int p = 0; p < npts; p++ ){
+        phi[ldphi + p] = (z[p] - alpha[0])*rb;
+      }
+    }
+    for ( int k = 1; k < d; k++ ){
+      const double a  = alpha[k];
+      const double b  = beta[k];
+      const double rb = 1.0/beta[k+1];
+      const scalar *phim1 = &phi[(k-1)*ldphi];
+      const scalar *phik  = &phi[k*ldphi];
+      scalar *phip1 = &phi[(k+1)*ldphi];
+      for ( int p = 0; p < npts; p++ ){
+        phip1[p] = ((z[p] - a)*phik[p] - b*phim1[p])*rb;
+      }
+    }
+  }
+
+  /*
+    Portable elementwise product
+  */
+  void multiplyGeneric( int npts, const scalar *x, scalar *y ){
+    for ( int p = 0; p < npts; p++ ){
+      y[p] *= x[p];
+    }
+  }
+
+#ifdef PSPACE_VECTOR_DISPATCH
+  /*
+    Recurrence on blocks of 4 points with AVX2
+  */
+  __attribute__((target("avx2")))
+  void recurrenceAVX2( int npts, const double *z, int d,
+                       const double *alpha, const double *beta,
+                       double *phi, int ldphi ){
+    std::vector<double> rbeta(d+1);
+    for ( int k = 1; k <= d; k++ ){
+      rbeta[k] = 1.0/beta[k];
+    }
+    int p = 0;
+    for ( ; p + 4 <= npts; p += 4 ){
+      __m256d zp  = _mm256_loadu_pd(&z[p]);
+      __m256d pm1 = _mm256_set1_pd(1.0);
+      _mm256_storeu_pd(&phi[p], pm1);
+      if ( d > 0 ){
+        __m256d pk = _mm256_mul_pd(_mm256_sub_pd(zp, _mm256_set1_pd(alpha[0])),
+                                   _mm256_set1_pd(rbeta[1]));
+        _mm256_storeu_pd(&phi[ldphi + p], pk);
+        for ( int k = 1; k < d; k++ ){
+          __m256d t = _mm256_mul_pd(_mm256_sub_pd(zp, _mm256_set1_pd(alpha[k])), pk);
+          t = _mm256_sub_pd(t, _mm256_mul_pd(_mm256_set1_pd(beta[k]), pm1));
+          __m256d pp1 = _mm256_mul_pd(t, _mm256_set1_pd(rbeta[k+1]));
+          _mm256_storeu_pd(&phi[(k+1)*ldphi + p], pp1);
+          pm1 = pk;
+          pk  = pp1;
+        }
+      }
+    }
+    if ( p < npts ){
+      recurrenceGeneric(npts - p, &z[p], d, alpha, beta, &phi[p], ldphi);
+    }
+  }
+
+  /*
+    Elementwise product on blocks of 4 points with AVX2
+  */
+  __attribute__((target("avx2")))
+  void multiplyAVX2( int npts, const double *x, double *y ){
+    int p = 0;
+    for ( ; p + 4 <= npts; p += 4 ){
+      _mm256_storeu_pd(&y[p], _mm256_mul_pd(_mm256_loadu_pd(&y[p]),
+                                            _mm256_loadu_pd(&x[p])));
+    }
+    multiplyGeneric(npts - p, &x[p], &y[p]);
+  }
+
+  /*
+    Recurrence on blocks of 8 points with AVX-512
+  */
+  __attribute__((target("avx512f")))
+  void recurrenceAVX512( int npts, const double *z, int d,
+                         const double *alpha, const double *beta,
+                         double *phi, int ldphi ){
+    std::vector<double> rbeta(d+1);
+    for ( int k = 1; k <= d; k++ ){
+      rbeta[k] = 1.0/beta[k];
+    }
+    int p = 0;
+    for ( ; p + 8 <= npts; p += 8 ){
+      __m512d zp  = _mm512_loadu_pd(&z[p]);
+      __m512d pm1 = _mm512_set1_pd(1.0);
+      _mm512_storeu_pd(&phi[p], pm1);
+      if ( d > 0 ){
+        __m512d pk = _mm512_mul_pd(_mm512_sub_pd(zp, _mm512_set1_pd(alpha[0])),
+                                   _mm512_set1_pd(rbeta[1]));
+        _mm512_storeu_pd(&phi[ldphi + p], pk);
+        for ( int k = 1; k < d; k++ ){
+          __m512d t = _mm512_mul_pd(_mm512_sub_pd(zp, _mm512_set1_pd(alpha[k])), pk);
+          t = _mm512_sub_pd(t, _mm512_mul_pd(_mm512_set1_pd(beta[k]), pm1));
+          __m512d pp1 = _mm512_mul_pd(t, _mm512_set1_pd(rbeta[k+1]));
+          _mm512_storeu_pd(&phi[(k+1)*ldphi + p], pp1);
+          pm1 = pk;
+          pk  = pp1;
+        }
+      }
+    }
+    if ( p < npts ){
+      recurrenceAVX2(npts - p, &z[p], d, alpha, beta, &phi[p], ldphi);
+    }
+  }
+
+  /*
+    Elementwise product on blocks of 8 points with AVX-512
+  */
+  __attribute__((target("avx512f")))
+  void multiplyAVX512( int npts, const double *x, double *y ){
+    int p = 0;
+    for ( ; p + 8 <= npts; p += 8 ){
+      _mm512_storeu_pd(&y[p], _mm512_mul_pd(_mm512_loadu_pd(&y[p]),
+                                            _mm512_loadu_pd(&x[p])));
+    }
+    multiplyAVX2(npts - p, &x[p], &y[p]);
+  }
+#endif // PSPACE_VECTOR_DISPATCH
+
+  /*
+    Kernels selected for the host CPU
+  */
+  struct KernelTable {
+    void (*recurrence)(int, const scalar*, int,
+                       const double*, const double*, scalar*, int);
+    void (*multiply)(int, const scalar*, scalar*);
+    const char *name;
+  };
+
+  KernelTable selectKernels(){
+    KernelTable table = { recurrenceGeneric, multiplyGeneric, "generic" };
+#ifdef PSPACE_VECTOR_DISPATCH
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports("avx512f") ){
+      table.recurrence = recurrenceAVX512;
+      table.multiply   = multiplyAVX512;
+      table.name       = "avx512";
+    } else if ( __builtin_cpu_supports("avx2") ){
+      table.recurrence = recurrenceAVX2;
+      table.multiply   = multiplyAVX2;
+      table.name       = "avx2";
+    }
+#endif
+    return table;
+  }
+
+  const KernelTable& getKernels(){
+    static const KernelTable table = selectKernels();
+    return table;
+  }
+}
+
+/**
+   Evaluate the orthonormal polynomials of degree 0..d at an array of
+   points from the three-term recurrence. The value of degree k at
+   point p is stored in phi[k*ldphi + p].
+
+   @param npts the number of points
+   @param z the points to evaluate the polynomials
+   @param d the maximum degree
+   @param alpha the diagonal recurrence coefficients
+   @param beta the off-diagonal recurrence coefficients
+   @param phi returns the values of each degree at each point
+   @param ldphi the leading dimension of phi (at least npts)
+*/
+void VectorKernels::recurrence( int npts, const scalar *z, int d,
+                                const double *alpha, const double *beta,
+                                scalar *phi, int ldphi ){
+  getKernels().recurrence(npts, z, d, alpha, beta, phi, ldphi);
+}
+
+/**
+   Multiply the entries of y by the entries of x
+
+   @param npts the number of entries
+   @param x the multiplier
+   @param y the array scaled in place
+*/
+void VectorKernels::multiply( int npts, const scalar *x, scalar *y ){
+  getKernels().multiply(npts, x, y);
+}
+
+/**
+   Returns the name of the instruction set used by the kernels
+*/
+const char* VectorKernels::getInstructionSet(){
+  return getKernels().name;
+}
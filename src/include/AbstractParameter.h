@@ -3,6 +3,7 @@
 
 #include "scalar.h"
 #include "GaussianQuadrature.h"
+#include "NestedQuadrature.h"
 #include "OrthogonalPolynomials.h"
 #include <stdio.h>
 #include <list>
@@ -20,28 +21,45 @@ class AbstractParameter {
   AbstractParameter();
   ~AbstractParameter();
 
+  // Univariate quadrature rules (numbered as NestedQuadrature rules)
+  enum QuadratureRule { GAUSS = 0, CLENSHAW_CURTIS = 1,
+                        GAUSS_PATTERSON = 2, GENZ_KEISTER = 3 };
+
   // Deferred procedures
   //---------------------
   virtual void quadrature(int npoints, scalar *z, scalar *y, scalar *w) = 0;
   virtual scalar basis(scalar z, int d) = 0;
+  virtual void basis(scalar z, int d, scalar *phi) = 0;
+  virtual void basis(int npts, const scalar *z, int d,
+                     scalar *phi, int ldphi) = 0;
 
   // Accessors
   //--------------------
   int getParameterID();
   int getMaxDegree();
+  int getQuadratureRule();
+  int getQuadratureSize(int level);
+  int getQuadratureDegree(int level);
+  int getQuadratureLevel(int npoints);
 
   // Mutators
   //--------------------
   void setParameterID(int pid);
   void setMaxDegree(int dmax);
+  void setQuadratureRule(int rule);
 
  protected:
+  // Quadrature rules available for the distribution
+  virtual bool hasQuadratureRule(int rule);
+
   GaussianQuadrature *gauss;
+  NestedQuadrature *nested;
   OrthogonalPolynomials *polyn;
 
  private:
   int parameter_id;
   int dmax;
+  int quadrature_rule;
 };
 
 #endif
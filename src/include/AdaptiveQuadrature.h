@@ -0,0 +1,78 @@
+#ifndef ADAPTIVE_QUADRATURE
+#define ADAPTIVE_QUADRATURE
+
+#include <map>
+#include <vector>
+
+#include "scalar.h"
+#include "ParameterContainer.h"
+
+/**
+   Dimension-adaptive sparse grid quadrature (Gerstner and Griebel).
+
+   Starting from the coarsest rule, the level index with the largest
+   hierarchical surplus of the quantities of interest is refined in
+   each parameter direction, so that the points concentrate in the
+   directions that matter. The refinement stops when the sum of the
+   surpluses of the candidate indices drops below the tolerance
+   relative to the integral or below an absolute tolerance (so that
+   quantities with a zero mean converge), or when the number of
+   evaluations would exceed the budget. Evaluations are cached by
+   point, so nested rules never evaluate a point twice.
+
+   The adapted level set can be handed to the parameter container to
+   serve the anisotropic grid through quadrature(q, zq, yq).
+
+   @author Komahan Boopathy
+*/
+class AdaptiveQuadrature {
+ public:
+  // Quantities of interest at a point: fq = f(zq, yq)
+  typedef void (*QuantityOfInterest)(void *ctx, const scalar *zq,
+                                     const scalar *yq, scalar *fq);
+
+  // Constructor and destructor
+  AdaptiveQuadrature(ParameterContainer *pc, int nfuncs);
+  ~AdaptiveQuadrature();
+
+  // Adapt the grid and integrate the quantities of interest, until the
+  // error estimate is below max(tol*max_k |fmean_k|, atol)
+  int integrate(QuantityOfInterest func, void *ctx,
+                double tol, int max_evals, scalar *fmean,
+                double atol=1.0e-14);
+
+  // Accessors
+  double getErrorEstimate();
+  int getNumEvaluations();
+  int getNumLevels();
+  void getLevels(int *levels);
+
+ private:
+  // Univariate rule of a parameter at a level
+  void getRule(int i, int level, int *npts,
+               const scalar **z, const scalar **y, const scalar **w);
+
+  // Hierarchical surplus of a level index
+  int computeSurplus(const std::vector<int> &index,
+                     QuantityOfInterest func, void *ctx,
+                     int max_evals, scalar *delta);
+
+  // Surplus magnitude used to order the refinement
+  double indicator(const scalar *delta);
+
+  ParameterContainer *pc;
+  int nvars, nfuncs;
+
+  // Univariate rules of each parameter at each level
+  std::vector< std::vector< std::vector<scalar> > > zrule, yrule, wrule;
+
+  // Quantities of interest at each evaluated point
+  std::map<std::vector<double>, std::vector<scalar> > fcache;
+
+  // Refined (old) and candidate (active) level indices
+  std::map<std::vector<int>, std::vector<scalar> > old_set, active_set;
+
+  double error_estimate;
+};
+
+#endif
@@ -1,8 +1,15 @@
+#ifndef GAUSSIAN_QUADRATURE
+#define GAUSSIAN_QUADRATURE
+
 #include "scalar.h"
 
 /**
   Class to return points and weights for Gaussian Quadrature
 
+  The rules are generated for any number of points from the
+  three-term recurrence of the orthonormal polynomials and memoized
+  in a process-wide cache keyed by (family, npoints).
+
   Author: Komahan Boopathy (komahanboopathy@gmail.com)
 */
 class GaussianQuadrature {
@@ -11,6 +18,9 @@ class GaussianQuadrature {
   GaussianQuadrature();
   ~GaussianQuadrature();
 
+  // Quadrature families (numbered as OrthogonalPolynomials families)
+  enum QuadratureFamily { HERMITE = 0, LEGENDRE = 1, LAGUERRE = 2 };
+
   // Quadrature implementations
   void hermiteQuadrature(int npoints, scalar mu, scalar sigma,
                          scalar *z, scalar *y, scalar *w);
@@ -18,4 +28,14 @@ class GaussianQuadrature {
                           scalar *z, scalar *y, scalar *w);
   void laguerreQuadrature(int npoints, scalar mu, scalar beta,
                           scalar *z, scalar *y, scalar *w);
+
+  // Access the cached rule in the standard probabilistic domain
+  static void getRule(int family, int npoints,
+                      const double **z, const double **w);
+
+ private:
+  // Generate a rule from the recurrence (Golub-Welsch and Newton)
+  static void computeRule(int family, int npoints, double *z, double *w);
 };
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef MATRIX_KERNELS
+#define MATRIX_KERNELS
+
+#include "scalar.h"
+
+/**
+   Dense matrix kernels used to map between the coefficients of the
+   basis terms and the values at the quadrature points in one level-3
+   operation, e.g. the states at all points from the basis table times
+   the coefficients of all nodal variables. Matrices are row-major.
+
+   Builds with PSPACE_USE_CBLAS call the CBLAS gemm of the linked BLAS
+   (link with -lcblas or the vendor library); the fallback is a
+   cache-blocked loop.
+
+   @author Komahan Boopathy
+*/
+class MatrixKernels {
+ public:
+  // C = alpha*op(A)*op(B) + beta*C, where op(A) is m x k, op(B) is
+  // k x n and op(X) is X or its transpose when trans is nonzero
+  static void gemm(int transa, int transb, int m, int n, int k,
+                   scalar alpha, const scalar *A, int lda,
+                   const scalar *B, int ldb,
+                   scalar beta, scalar *C, int ldc);
+
+  // Name of the backend performing the products
+  static const char* getBackend();
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef NESTED_QUADRATURE
+#define NESTED_QUADRATURE
+
+#include "scalar.h"
+
+/**
+  Class to return points and weights of nested quadrature rules, whose
+  points at each level contain the points of the previous level:
+  Clenshaw-Curtis and Gauss-Patterson rules for uniform parameters and
+  Genz-Keister rules for normal parameters.
+
+  The Gauss-Patterson and Genz-Keister rules are generated as
+  Kronrod-Patterson extensions of the one point Gauss rule from the
+  three-term recurrence of the orthonormal polynomials. All rules are
+  memoized in a process-wide cache keyed by (rule, level).
+
+  The Clenshaw-Curtis and Gauss-Patterson weights are positive at all
+  levels. The Genz-Keister weights are only guaranteed positive up to
+  level 3 (9 points): level 4 (19 points) has a negative weight of
+  about -6.3e-3 and level 5 (35 points) has weights down to 1e-18, so
+  do not rely on positivity of the Genz-Keister rules from level 4 on.
+
+  Author: Komahan Boopathy (komahanboopathy@gmail.com)
+*/
+class NestedQuadrature {
+ public:
+  // Constructor and destructor
+  NestedQuadrature();
+  ~NestedQuadrature();
+
+  // Nested rule families
+  enum NestedRule { CLENSHAW_CURTIS = 1, GAUSS_PATTERSON = 2, GENZ_KEISTER = 3 };
+
+  // Quadrature implementations (npoints must be a size of the rule)
+  void clenshawCurtisQuadrature(int npoints, scalar a, scalar b,
+                                scalar *z, scalar *y, scalar *w);
+  void gaussPattersonQuadrature(int npoints, scalar a, scalar b,
+                                scalar *z, scalar *y, scalar *w);
+  void genzKeisterQuadrature(int npoints, scalar mu, scalar sigma,
+                             scalar *z, scalar *y, scalar *w);
+
+  // Number of points and polynomial degree of a rule at a level (1, 2, ...)
+  static int getNumPoints(int rule, int level);
+  static int getDegree(int rule, int level);
+  static int getMaxLevel(int rule);
+
+  // Access the cached rule in the standard probabilistic domain
+  static void getRule(int rule, int level,
+                      const double **z, const double **w);
+
+ private:
+  // Level of the rule with npoints, or -1 when not a size of the rule
+  static int getLevel(int rule, int npoints);
+
+  // Generate the Clenshaw-Curtis rule with npoints
+  static void computeClenshawCurtis(int npoints, double *z, double *w);
+
+  // Extend a rule with new points to maximize the polynomial degree
+  static void computeExtension(int family, int nbase, const double *zbase,
+                               int npoints, double *z, double *w);
+};
+
+#endif
@@ -15,6 +15,12 @@ class NormalParameter : AbstractParameter{
   // Member functions
   void quadrature(int npoints, scalar *z, scalar *y, scalar *w);
   scalar basis(scalar z, int d);
+  void basis(scalar z, int d, scalar *phi);
+  void basis(int npts, const scalar *z, int d, scalar *phi, int ldphi);
+
+ protected:
+  bool hasQuadratureRule(int rule);
+
  private:
   // Member variables
   scalar mu;
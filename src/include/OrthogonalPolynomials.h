@@ -1,3 +1,6 @@
+#ifndef ORTHOGONAL_POLYNOMIALS
+#define ORTHOGONAL_POLYNOMIALS
+
 #include "scalar.h"
 
 /**
@@ -11,6 +14,9 @@ class OrthogonalPolynomials {
   OrthogonalPolynomials();
   ~OrthogonalPolynomials();
 
+  // Polynomial families
+  enum PolynomialFamily { HERMITE = 0, LEGENDRE = 1, LAGUERRE = 2 };
+
   // Get Hermite polynomials  -- Normal distribution
   scalar hermite(scalar z, int d);
   scalar unit_hermite(scalar z, int d);
@@ -23,10 +29,21 @@ class OrthogonalPolynomials {
   scalar laguerre(scalar z, int d);
   scalar unit_laguerre(scalar z, int d);
 
+  // Get orthonormal polynomials of all degrees 0..d in one pass
+  void unit_polynomials(int family, scalar z, int d, scalar *phi);
+  void unit_polynomials(int family, int npts, const scalar *z, int d,
+                        scalar *phi, int ldphi);
+
+  // Recurrence coefficients of the orthonormal polynomials
+  static void recurrence(int family, int n, double *alpha, double *beta);
+
  private:
+  // Orthonormal polynomial of degree d by a rolling recurrence
+  scalar unit_polynomial(int family, scalar z, int d);
+  static void coefficients(int family, int k, double *alpha, double *beta);
+
   // Useful functions
   scalar factorial(int n);
-  scalar comb(int n, int r);
 
   // hermite algorithms
   scalar explicit_hermite(scalar z, int d);
@@ -38,5 +55,7 @@ class OrthogonalPolynomials {
 
   // Legendre algorithms
   scalar explicit_legendre(scalar z, int d);
-  scalar general_legendre(scalar z, int d);
+  scalar recursive_legendre(scalar z, int d);
 };
+
+#endif
@@ -26,31 +26,68 @@ class ParameterContainer {
 
   // Evaluate basis at quadrature points
   scalar quadrature(int q, scalar *zq, scalar *yq);
+  int quadrature(int qstart, int npts, scalar **zq, scalar **yq, scalar *wq);
   scalar basis(int k, scalar *z);
+  void basis(int k, int npts, scalar **z, scalar *psi);
 
   // Accessors
   int getNumBasisTerms();
   int getNumParameters();
+  AbstractParameter* getParameter(int pid);
   int getNumQuadraturePoints();
+  int getQuadratureChunkSize();
+  void getTensorQuadrature(int pid, int *npts,
+                           const scalar **z, const scalar **w);
   void getBasisParamDeg(int k, int *degs);
   void getBasisParamMaxDeg(int *pmax);
 
+  // Basis evaluated at quadrature points (psi_k(z_q) and w_q psi_k(z_q))
+  const scalar* getBasisRow(int k);
+  const scalar* getBasisColumn(int q);
+  const scalar* getWeightedBasisRow(int k);
+  const scalar* getWeightedBasisColumn(int q);
+  void getBasisTableStrides(int *ldq, int *ldk);
+
+  // Moments of quantities from their projections on the basis terms
+  scalar getMean(const scalar *c, int inc=1);
+  scalar getVariance(const scalar *c, int inc=1);
+  scalar getCovariance(const scalar *a, const scalar *b, int inc=1);
+
   // Initiliazation tasks
-  void initialize();
+  void initialize(bool build_basis_table=false);
   void initializeBasis(const int *pmax);
   void initializeQuadrature(const int *nqpts);
+  void initializeQuadrature(int nindices, const int *levels);
+  void initializeBasisTable();
 
  private:
+  void deallocateQuadrature();
+  void deallocateBasisTable();
+
   // Maintain a map of parameters
   std::map<int,AbstractParameter*> pmap;
 
   int tnum_parameters;        // total number of parameters
   int tnum_basis_terms;       // total number of basis terms
   int tnum_quadrature_points; // total number of quadrature points
+  int qnum_parameters;        // number of parameters of the quadrature
 
   int *param_max_degree;   // maximum monomial degree of each parameter
-  int **dindex;         // parameterwise degree for each basis entry
-  scalar **Z, **Y, *W;
+  int *param_nqpts;        // number of quadrature points of each parameter
+  int *param_rule;         // quadrature rule of each parameter
+  int *dindex;          // parameterwise degree for each basis entry (k*nvars+i)
+  scalar **Z, **Y, *W;      // stored points of sparse grids
+
+  // Univariate rules of tensor grids, whose points are generated on
+  // the fly instead of stored
+  int *tensor_nqpts;
+  scalar **zp, **yp, **wp;
+
+  // Aligned tables of basis at quadrature points stored termwise
+  // (nsterms x ldq) and pointwise (nqpts x ldk), plain and weighted
+  scalar *basis_table;
+  scalar *psi_kq, *psi_qk, *wpsi_kq, *wpsi_qk;
+  int ldq, ldk;
 
   // Helpers to access basis evaluation and quadrature points
   BasisHelper *bhelper;
@@ -2,10 +2,12 @@
 #define QUADRATURE_HELPER
 
 #include "scalar.h"
+#include "AbstractParameter.h"
 
 /**
    Class that performs multivariate quadrature from univariate
-   quadrature
+   quadrature, either as a full tensor product or as a Smolyak sparse
+   grid combining tensor products of low order rules
 
    @author Komahan Boopathy
  */
@@ -15,11 +17,31 @@ class QuadratureHelper {
   QuadratureHelper(int quadrature_type=0);
   ~QuadratureHelper();
 
+  // Multivariate quadrature types
+  enum QuadratureType { TENSOR = 0, SPARSE = 1 };
+  int getQuadratureType();
+
   // Find tensor product of 1d rules
   void tensorProduct(const int nvars, const int *nqpts,
                      scalar **zp, scalar **yp, scalar **wp,
                      scalar **zz, scalar **yy, scalar *ww);
 
+  // Find a chunk of points of the tensor product of 1d rules
+  void tensorProduct(const int nvars, const int *nqpts,
+                     scalar **zp, scalar **yp, scalar **wp,
+                     int qstart, int npoints,
+                     scalar **zz, scalar **yy, scalar *ww);
+
+  // Smolyak sparse grid of 1d rules with up to nqpts points
+  int sparseGrid(const int nvars, const int *nqpts,
+                 AbstractParameter **params,
+                 scalar ***zz, scalar ***yy, scalar **ww);
+
+  // Combination of tensor rules over a downward closed set of levels
+  int combinationRule(const int nvars, const int nindices,
+                      const int *levels, AbstractParameter **params,
+                      scalar ***zz, scalar ***yy, scalar **ww);
+
  private:
   int quadrature_type;
 };
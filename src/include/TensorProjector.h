@@ -0,0 +1,52 @@
+#ifndef TENSOR_PROJECTOR
+#define TENSOR_PROJECTOR
+
+#include "scalar.h"
+#include "ParameterContainer.h"
+
+/**
+   Sum-factorized projection onto the polynomial basis over tensor
+   product quadrature.
+
+   The basis and the quadrature are both tensor products, so the
+   projection of values at the nqpts points onto the nsterms basis
+   terms is applied one parameter at a time with the univariate tables
+   phi_i(a, j) = phi_a(z_j) and w_j phi_i(a, j). This costs
+   O(nqpts*sum_i P_i) per quantity instead of O(nqpts*nsterms), where
+   P_i is the number of degrees of parameter i. The reverse operation
+   reconstructs the values at the points from the coefficients.
+
+   Values at quadrature points are laid out as fq[q*ndata + m] and
+   coefficients as fk[k*ndata + m] for the m-th quantity, in the order
+   of the quadrature points and basis terms of the container. The
+   tables are built at construction from the initialized container.
+
+   @author Komahan Boopathy
+*/
+class TensorProjector {
+ public:
+  // Constructor and destructor
+  TensorProjector(ParameterContainer *pc);
+  ~TensorProjector();
+
+  // Values at quadrature points to coefficients and back
+  void project(int ndata, const scalar *fq, scalar *fk);
+  void reconstruct(int ndata, const scalar *fk, scalar *fq);
+
+ private:
+  // Apply a univariate table along one axis of a tensor
+  void contract(int outer, int nin, int nout, int inner,
+                const scalar *A, int lda, int transpose,
+                const scalar *in, scalar *out);
+
+  ParameterContainer *pc;
+  int nvars, nsterms, nqpts;
+  int *npts;       // number of quadrature points of each parameter
+  int *ndeg;       // number of degrees of each parameter (P_i)
+  int *offset;     // offset of each basis term in the coefficient tensor
+  scalar **phi;    // univariate basis at points, phi[i][a*npts[i] + j]
+  scalar **wphi;   // weighted univariate basis
+  int max_size;    // largest intermediate tensor per quantity
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef VECTOR_KERNELS
+#define VECTOR_KERNELS
+
+#include "scalar.h"
+
+/**
+   Kernels that evaluate the polynomial recurrences and basis products
+   across many points at once. In real builds the kernels run 4 (AVX2)
+   or 8 (AVX-512) points per instruction, selected at runtime from the
+   CPU features, with a portable loop as fallback. Complex builds
+   always use the portable loop.
+
+   @author Komahan Boopathy
+*/
+class VectorKernels {
+ public:
+  // Orthonormal polynomials of degree 0..d at npts points
+  static void recurrence(int npts, const scalar *z, int d,
+                         const double *alpha, const double *beta,
+                         scalar *phi, int ldphi);
+
+  // Elementwise product y[p] *= x[p]
+  static void multiply(int npts, const scalar *x, scalar *y);
+
+  // Name of the instruction set selected at runtime
+  static const char* getInstructionSet();
+};
+
+#endif
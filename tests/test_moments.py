@@ -0,0 +1,44 @@
+import pspace.PSPACE as uq
+import numpy as np
+
+pfactory = uq.PyParameterFactory()
+y1 = pfactory.createNormalParameter(mu=1.0,sigma=0.1,dmax=2)
+y2 = pfactory.createUniformParameter(a=1.0,b=0.1,dmax=2)
+y3 = pfactory.createExponentialParameter(mu=1.0,beta=0.1,dmax=2)
+
+pc = uq.PyParameterContainer(1)
+pc.addParameter(y1)
+pc.addParameter(y2)
+pc.addParameter(y3)
+
+pc.initialize()
+
+# Moments from the projected coefficients against quadrature
+def f(y):
+    return y[0]*y[1] + y[2]
+
+nterms = pc.getNumBasisTerms()
+c = np.zeros(nterms)
+fmean = 0.0
+fsqr = 0.0
+for q in range(pc.getNumQuadraturePoints()):
+    wq, zq, yq = pc.quadrature(q)
+    fq = f(yq)
+    fmean += wq*fq
+    fsqr += wq*fq*fq
+    for k in range(nterms):
+        c[k] += wq*pc.basis(k, zq)*fq
+fvar = fsqr - fmean*fmean
+
+print("mean", pc.getMean(c), fmean)
+print("variance", pc.getVariance(c), fvar)
+assert(np.isclose(pc.getMean(c), fmean))
+assert(np.isclose(pc.getVariance(c), fvar))
+assert(np.isclose(pc.getCovariance(c, c), fvar))
+
+# Too few coefficients are rejected
+try:
+    pc.getMean(c[:-1])
+    assert(False)
+except ValueError:
+    pass
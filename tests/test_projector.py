@@ -0,0 +1,37 @@
+import pspace.PSPACE as uq
+import numpy as np
+
+# Tensor basis on the tensor Gauss grid
+pfactory = uq.PyParameterFactory()
+y1 = pfactory.createNormalParameter(mu=1.0, sigma=0.1, dmax=3)
+y2 = pfactory.createUniformParameter(a=1.0, b=2.0, dmax=2)
+y3 = pfactory.createExponentialParameter(mu=1.0, beta=0.1, dmax=4)
+
+pc = uq.PyParameterContainer(0, 0)
+pc.addParameter(y1)
+pc.addParameter(y2)
+pc.addParameter(y3)
+pc.initialize()
+
+nterms = pc.getNumBasisTerms()
+nqpts = pc.getNumQuadraturePoints()
+
+# Values of a quantity at the quadrature points and its projection on
+# each basis term, summed point by point
+fq = np.zeros(nqpts)
+fk = np.zeros(nterms)
+for q in range(nqpts):
+    wq, zq, yq = pc.quadrature(q)
+    fq[q] = np.exp(yq[0]*yq[1]) + np.sin(yq[2])
+    for k in range(nterms):
+        fk[k] += wq*pc.basis(k, zq)*fq[q]
+
+# The sum-factorized projection matches the direct one, and the tensor
+# basis interpolates on the tensor grid, so the values are recovered
+projector = uq.PyTensorProjector(pc)
+tk = projector.project(fq)
+tq = projector.reconstruct(tk)
+print("projection error", np.max(np.abs(tk - fk)))
+print("reconstruction error", np.max(np.abs(tq - fq)))
+assert(np.allclose(tk, fk, rtol=1.0e-12, atol=1.0e-12))
+assert(np.allclose(tq, fq, rtol=1.0e-12, atol=1.0e-12))
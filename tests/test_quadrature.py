@@ -0,0 +1,83 @@
+import pspace.PSPACE as uq
+import numpy as np
+
+# Quadrature rules of a parameter (AbstractParameter::QuadratureRule)
+GAUSS, CLENSHAW_CURTIS, GAUSS_PATTERSON, GENZ_KEISTER = 0, 1, 2, 3
+
+# Types of the parameter container
+TENSOR, COMPLETE = 0, 1
+SPARSE = 1
+
+def orthonormality_error(pc):
+    """
+    Largest entry of the Gram matrix of the basis under the quadrature
+    of the container, minus the identity
+    """
+    nterms = pc.getNumBasisTerms()
+    A = np.zeros((nterms, nterms))
+    for q in range(pc.getNumQuadraturePoints()):
+        wq, zq, yq = pc.quadrature(q)
+        psi = np.array([pc.basis(k, zq) for k in range(nterms)])
+        A += wq*np.outer(psi, psi)
+    return np.max(np.abs(A - np.eye(nterms)))
+
+def container(basis_type, quadrature_type, rules):
+    """
+    Container of a normal, a uniform and an exponential parameter with
+    the given quadrature rules (each container takes a new factory)
+    """
+    pfactory = uq.PyParameterFactory()
+    y1 = pfactory.createNormalParameter(mu=1.0, sigma=0.1, dmax=3)
+    y2 = pfactory.createUniformParameter(a=1.0, b=2.0, dmax=3)
+    y3 = pfactory.createExponentialParameter(mu=1.0, beta=0.1, dmax=3)
+    y1.setQuadratureRule(rules[0])
+    y2.setQuadratureRule(rules[1])
+    y3.setQuadratureRule(rules[2])
+    pc = uq.PyParameterContainer(basis_type, quadrature_type)
+    pc.addParameter(y1)
+    pc.addParameter(y2)
+    pc.addParameter(y3)
+    pc.initialize()
+    return pc
+
+# Each level of a nested rule holds the points of the level below
+for rule in [CLENSHAW_CURTIS, GAUSS_PATTERSON, GENZ_KEISTER]:
+    for level in range(1, uq.PyNestedQuadrature.getMaxLevel(rule)):
+        zc, wc = uq.PyNestedQuadrature.getRule(rule, level)
+        zf, wf = uq.PyNestedQuadrature.getRule(rule, level+1)
+        print("rule", rule, "level", level, len(zc), "->", len(zf))
+        assert(len(zf) == uq.PyNestedQuadrature.getNumPoints(rule, level+1))
+        for z in zc:
+            assert(np.min(np.abs(zf - z)) < 1.0e-12)
+        assert(np.isclose(np.sum(wf), 1.0))
+
+# The basis stays orthonormal on the tensor and sparse grids of the
+# Gauss and the nested rules
+gauss = [GAUSS, GAUSS, GAUSS]
+nested = [GENZ_KEISTER, CLENSHAW_CURTIS, GAUSS]
+for name, basis_type, quadrature_type, rules in [
+        ("tensor gauss", TENSOR, TENSOR, gauss),
+        ("tensor nested", TENSOR, TENSOR, nested),
+        ("sparse gauss", COMPLETE, SPARSE, gauss),
+        ("sparse nested", COMPLETE, SPARSE, nested)]:
+    pc = container(basis_type, quadrature_type, rules)
+    err = orthonormality_error(pc)
+    print(name, pc.getNumQuadraturePoints(), "points, error", err)
+    assert(err < 1.0e-10)
+
+# Adaptive quadrature of exp(y1 + y2) with y1, y2 uniform on [0, 1]
+pfactory = uq.PyParameterFactory()
+y1 = pfactory.createUniformParameter(a=0.0, b=1.0, dmax=2)
+y2 = pfactory.createUniformParameter(a=0.0, b=1.0, dmax=2)
+y1.setQuadratureRule(CLENSHAW_CURTIS)
+y2.setQuadratureRule(CLENSHAW_CURTIS)
+pc = uq.PyParameterContainer(TENSOR, TENSOR)
+pc.addParameter(y1)
+pc.addParameter(y2)
+pc.initialize()
+
+exact = (np.exp(1.0) - 1.0)**2
+adaptive = uq.PyAdaptiveQuadrature(pc, 1)
+fmean = adaptive.integrate(lambda z, y: np.exp(y[0] + y[1]), 1.0e-10, 2000)
+print("adaptive", fmean[0], exact, adaptive.getNumEvaluations(), "evaluations")
+assert(abs(fmean[0] - exact) < 1.0e-8*exact)